@@ -0,0 +1,87 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Benchmark comparing density and CPU cost of codecs.
+ *
+ * For every codec prints number of data bytes carried by one query with given base host and speed of encoding and
+ * decoding of query-sized chunks (time per query and throughput of raw data).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/codec.h"
+#include "../common/definitions.h"
+
+/// Amount of raw data encoded and decoded by every codec
+#define BENCH_BYTES (64 * 1024 * 1024)
+
+/**
+ * Returns current time in nanoseconds (monotonic clock).
+ *
+ * @return Time in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int const argc, char *const argv[]) {
+    char const *const BASE_HOST = argc > 1 ? argv[1] : "example.com";
+    unsigned short const name_chars = DNS_MAX_NAME - strlen(BASE_HOST) - MAX_DOTS;
+    char *const data = malloc(BENCH_BYTES), *const encoded = malloc(2 * BENCH_BYTES), *const decoded = malloc(BENCH_BYTES);
+    volatile long check = 0; // keeps results of decoding alive
+
+    if (!data || !encoded || !decoded || strlen(BASE_HOST) + MAX_DOTS >= DNS_MAX_NAME) {
+        fprintf(stderr, "Usage: codec_bench [BASE_HOST]\n");
+        return 1;
+    }
+    srand(1);
+    for (long i = 0; i < BENCH_BYTES; i++) {
+        data[i] = (char) rand();
+    }
+    memset(encoded, 0, 2 * BENCH_BYTES); // page faults are not measured
+    memset(decoded, 0, BENCH_BYTES);
+
+    printf("base host: %s (%u characters for data)\n", BASE_HOST, name_chars);
+    printf("%-8s %12s %12s %14s %14s %14s %14s\n", "codec", "bytes/query", "vs base16", "encode ns/q", "decode ns/q", "encode MB/s", "decode MB/s");
+    for (unsigned char id = 0; codec_by_id(id); id++) {
+        struct codec const *const codec = codec_by_id(id);
+        size_t const chunk = codec_capacity(codec, name_chars);
+        size_t const queries = BENCH_BYTES / chunk;
+        size_t offset = 0;
+
+        // Encode query-sized chunks
+        long long start = now_ns();
+        for (size_t q = 0; q < queries; q++) {
+            offset += codec->encode(encoded + offset, data + q * chunk, chunk);
+        }
+        long long const encode_ns = now_ns() - start;
+
+        // Decode them back
+        size_t const encoded_chunk = offset / queries;
+        start = now_ns();
+        for (size_t q = 0; q < queries; q++) {
+            check += codec->decode(decoded + q * chunk, encoded + q * encoded_chunk, encoded_chunk);
+        }
+        long long const decode_ns = now_ns() - start;
+        if (memcmp(data, decoded, queries * chunk)) {
+            fprintf(stderr, "%s: decoded data differ\n", codec->name);
+            return 1;
+        }
+
+        printf("%-8s %12zu %11.2fx %14.1f %14.1f %14.1f %14.1f\n", codec->name, chunk,
+               (double) chunk / codec_capacity(codec_by_id(CODEC_BASE16), name_chars),
+               (double) encode_ns / queries, (double) decode_ns / queries,
+               queries * chunk * 1000.0 / encode_ns, queries * chunk * 1000.0 / decode_ns);
+    }
+
+    free(data);
+    free(encoded);
+    free(decoded);
+    return 0;
+}
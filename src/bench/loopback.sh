@@ -0,0 +1,100 @@
+# Benchmark bash script
+#
+# Runs receiver and concurrent senders over loopback on unprivileged port for every transport, set of sender options,
+# file size and concurrency and prints results (together with micro-benchmarks) as one JSON object:
+#   mb_per_s       data of all files divided by wall time of case
+#   packets_per_s  DNS messages processed by receiver (counted by its metrics) divided by wall time
+#   p50_ms, p99_ms latency of one transfer (run of sender until receiver acknowledged end of file)
+#
+# Usage: src/bench/loopback.sh (from root dir, after 'make'), configured by environment variables below
+
+PORT=${PORT:-15353}
+SIZES=${SIZES:-"1024 65536 1048576"}
+CONCURRENCY=${CONCURRENCY:-"1 4 16"}
+TRANSPORTS=${TRANSPORTS:-"tcp udp"}
+OPTIONS=${OPTIONS:-"plain;-e base32;-q 4;-c 4;-z 6"} # sets of sender options separated by ';', 'plain' is no option
+RUNS=${RUNS:-3}
+
+dir=$(mktemp -d);
+trap 'kill $receiver 2> /dev/null; rm -rf "$dir"' EXIT;
+
+./app/dns_receiver -p "$PORT" -L off -j 4 example.com "$dir"/recv 2> "$dir"/metrics & receiver=$!;
+sleep 0.3;
+
+# Prints number of DNS messages processed by receiver (sum of its workers from the last SIGUSR1 dump)
+packets() {
+  kill -USR1 $receiver;
+  sleep 0.2;
+  awk '/^# HELP dns_receiver_received_bytes_total/ { sum = 0 } /^dns_receiver_packets_total/ { sum += $2 } END { print sum + 0 }' "$dir"/metrics;
+}
+
+# Prints value of quantile of sorted numbers in file
+quantile() {
+  awk -v q="$2" '{ v[NR] = $1 } END { i = int(q * NR + 0.999999); if (i < 1) i = 1; print v[i] }' "$1";
+}
+
+echo "{";
+echo "\"micro\": $(./app/micro_bench),";
+echo "\"loopback\": [";
+first=1;
+IFS=';' read -r -a option_sets <<< "$OPTIONS";
+for transport in $TRANSPORTS;
+do
+  for k in "${!option_sets[@]}";
+  do
+    options=${option_sets[$k]};
+    [ "$options" = plain ] && options="";
+    # More questions per packet, parallel connections and resume are supported only by tcp transport
+    case "$transport $options" in
+      "udp "*-[qcr]*) continue;;
+    esac;
+    for size in $SIZES;
+    do
+      head -c "$size" /dev/urandom > "$dir"/src;
+      for concurrency in $CONCURRENCY;
+      do
+        : > "$dir"/latency;
+        ok=true;
+        wall=0;
+        before=$(packets);
+        for run in $(seq 1 "$RUNS");
+        do
+          start=$(date +%s%N);
+          senders="";
+          for i in $(seq 1 "$concurrency");
+          do
+            (
+              s=$(date +%s%N);
+              ./app/dns_sender -p "$PORT" -u 127.0.0.1 -t "$transport" $options -L off example.com "$transport/$k/$size/$concurrency/$run/$i" "$dir"/src 2> /dev/null;
+              echo $(( $(date +%s%N) - s )) >> "$dir"/latency;
+            ) & senders="$senders $!";
+          done;
+          wait $senders;
+          wall=$(( wall + $(date +%s%N) - start ));
+        done;
+        after=$(packets);
+
+        # Files are written behind by writer thread of receiver, it had time to finish while packets were counted
+        for run in $(seq 1 "$RUNS");
+        do
+          for i in $(seq 1 "$concurrency");
+          do
+            cmp -s "$dir"/src "$dir/recv/$transport/$k/$size/$concurrency/$run/$i" || ok=false;
+          done;
+        done;
+
+        sort -n "$dir"/latency -o "$dir"/latency;
+        [ $first = 1 ] || echo ",";
+        first=0;
+        awk -v t="$transport" -v o="$options" -v s="$size" -v c="$concurrency" -v r="$RUNS" -v w="$wall" -v p=$(( after - before )) \
+            -v p50="$(quantile "$dir"/latency 0.5)" -v p99="$(quantile "$dir"/latency 0.99)" -v ok="$ok" 'BEGIN {
+          printf "  {\"transport\": \"%s\", \"options\": \"%s\", \"size\": %d, \"concurrency\": %d, \"transfers\": %d, \"ok\": %s, ", t, o, s, c, c * r, ok;
+          printf "\"mb_per_s\": %.2f, \"packets_per_s\": %.0f, \"p50_ms\": %.2f, \"p99_ms\": %.2f}", s * c * r * 1000 / w, p * 1e9 / w, p50 / 1e6, p99 / 1e6;
+        }';
+      done;
+    done;
+  done;
+done;
+echo "";
+echo "]";
+echo "}";
@@ -0,0 +1,114 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Micro-benchmarks of hot paths of sender and receiver.
+ *
+ * Measures base16 encoding and decoding of query-sized chunks, building of DNS packet by sender and disassembling of
+ * it by receiver (events are inactive, as in transfer with log off). Results are printed as one JSON object.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../common/base16.h"
+#include "../common/codec.h"
+#include "../common/definitions.h"
+#include "../common/protocol.h"
+#include "../sender/template.h"
+#include "../receiver/session.h"
+
+/// Number of operations measured by every benchmark
+#define BENCH_OPS 2000000
+
+/// Number of different chunks operations cycle through (so branch predictor cannot learn single chunk)
+#define BENCH_CHUNKS 256
+
+/**
+ * Returns current time in nanoseconds (monotonic clock).
+ *
+ * @return Time in nanoseconds.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * Prints result of benchmark as member of JSON object.
+ *
+ * @param name Name of benchmark.
+ * @param ns Time of all operations in nanoseconds.
+ * @param bytes Raw data bytes processed by one operation.
+ * @param last Non-zero if it is the last member.
+ */
+static void bench_print(char const *const name, long long const ns, size_t const bytes, int const last) {
+    printf("  \"%s\": {\"ops\": %d, \"bytes_per_op\": %zu, \"ns_per_op\": %.1f, \"mb_per_s\": %.1f}%s\n", name, BENCH_OPS,
+           bytes, (double) ns / BENCH_OPS, (double) BENCH_OPS * bytes * 1000.0 / ns, last ? "" : ",");
+}
+
+int main(int const argc, char *const argv[]) {
+    char const *const BASE_HOST = argc > 1 ? argv[1] : "example.com";
+    struct codec const *const base16 = codec_by_id(CODEC_BASE16);
+    struct template template;
+    struct event event;
+    volatile long check = 0; // keeps results alive
+
+    if (strlen(BASE_HOST) + MAX_DOTS >= DNS_MAX_NAME) {
+        fprintf(stderr, "Usage: micro_bench [BASE_HOST]\n");
+        return 1;
+    }
+    template_init(&template, BASE_HOST);
+    event_init(&event);
+
+    // Chunks fill whole query, as chunks of transfer do
+    size_t const chunk = codec_capacity(base16, DNS_MAX_NAME - template.base.text_len - MAX_DOTS);
+    static char data[BENCH_CHUNKS][DNS_MAX_PACKET], encoded[BENCH_CHUNKS][2 * DNS_MAX_PACKET], decoded[DNS_MAX_PACKET];
+    static char packets[BENCH_CHUNKS][DNS_MAX_PACKET];
+    srand(1);
+    for (int i = 0; i < BENCH_CHUNKS; i++) {
+        for (size_t j = 0; j < chunk; j++) {
+            data[i][j] = (char) rand();
+        }
+    }
+
+    printf("{\n");
+
+    long long start = now_ns();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        b16_encode(encoded[i % BENCH_CHUNKS], data[i % BENCH_CHUNKS], chunk);
+    }
+    bench_print("b16_encode", now_ns() - start, chunk, 0);
+
+    start = now_ns();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        check += b16_decode(decoded, encoded[i % BENCH_CHUNKS], 2 * chunk);
+    }
+    bench_print("b16_decode", now_ns() - start, chunk, 0);
+
+    start = now_ns();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        check += build_dns_packet(data[i % BENCH_CHUNKS], chunk, &template, base16, PROTO_TYPE_DATA, packets[i % BENCH_CHUNKS], &event);
+    }
+    bench_print("build_dns_packet", now_ns() - start, chunk, 0);
+
+    start = now_ns();
+    for (int i = 0; i < BENCH_OPS; i++) {
+        char const *const dns = packets[i % BENCH_CHUNKS] + DNS_TCP;
+        unsigned short offset = DNS_HEADER;
+        check += disassemble_dns_packet(dns, ntohs(*((unsigned short *) packets[i % BENCH_CHUNKS])), &offset, &template.base, base16, decoded, &event);
+    }
+    long long const disassemble_ns = now_ns() - start;
+    if (memcmp(decoded, data[(BENCH_OPS - 1) % BENCH_CHUNKS], chunk)) {
+        fprintf(stderr, "disassembled data differ\n");
+        return 1;
+    }
+    bench_print("disassemble_dns_packet", disassemble_ns, chunk, 1);
+
+    printf("}\n");
+
+    return 0;
+}
@@ -32,4 +32,13 @@ void check_host_lex(const char *host) {
         err_handle("Invalid syntax of base domain (label ends with forbidden hyphen)",EXIT);
     if (cnt_d > 251)
         err_handle("Invalid syntax of base domain (domain too long >251)", EXIT);
+}
+
+void check_number_lex(char const *number, char const *const msg) {
+    if (!*number)
+        err_handle(msg, EXIT);
+    for (; *number; number++) {
+        if (!isdigit(*number))
+            err_handle(msg, EXIT);
+    }
 }
\ No newline at end of file
@@ -24,5 +24,14 @@
  */
 void check_host_lex(const char *host);
 
+/**
+ * Checks syntax of non-negative decimal integer (only digits, at least one). If invalid, prints error message and exits
+ * program.
+ *
+ * @param number Number string.
+ * @param msg Error message printed when number is invalid.
+ */
+void check_number_lex(char const *number, char const *const msg);
+
 // END GUARD
 #endif
\ No newline at end of file
@@ -3,20 +3,186 @@
  * @Email <xpavlo14@vutbr.cz>
  * @Project DNS Tunneling
  * @Program Base16 encoding and decoding.
+ *
+ * Every function has portable scalar implementation and, on x86, SSE2 and AVX2 implementations. Implementation is
+ * chosen by first call according to instruction sets supported by CPU.
  */
 
 #define MASK 0b00001111
 
 #include <stdlib.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#define B16_X86
+#include <immintrin.h>
+#endif
+
+#include "base16.h"
+
+/**
+ * Portable implementations (also used for tails of vector implementations).
+ */
+static void b16_encode_scalar(char *dst, char const *src, size_t n);
+static int b16_decode_scalar(char *dst, char const *src, size_t n);
+
+/**
+ * Chooses implementations by CPU, stores them into function pointers and calls them.
+ */
+static void b16_encode_resolve(char *dst, char const *src, size_t n);
+static int b16_decode_resolve(char *dst, char const *src, size_t n);
+
+/// Chosen implementations (resolved by first call)
+static void (*b16_encode_impl)(char *, char const *, size_t) = b16_encode_resolve;
+static int (*b16_decode_impl)(char *, char const *, size_t) = b16_decode_resolve;
+
+
 void b16_encode(char *dst, char const *src, size_t n) {
-    for (int i = 0; i < n*2; i++)
-        *(dst+i) = (i%2 ? *(src+i/2)&MASK : (unsigned char)*(src+i/2)>>4)+'A';
+    b16_encode_impl(dst, src, n);
+}
+
+int b16_decode(char *dst, char const *src, size_t n) {
+    return b16_decode_impl(dst, src, n & ~(size_t) 1);
+}
+
+static void b16_encode_scalar(char *dst, char const *src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        unsigned char const c = src[i];
+        dst[2*i] = (c >> 4) + 'A';
+        dst[2*i+1] = (c & MASK) + 'A';
+    }
+}
+
+static int b16_decode_scalar(char *dst, char const *src, size_t n) {
+    unsigned char invalid = 0;
+
+    for (size_t i = 0; i < n/2; i++) {
+        unsigned char const hi = src[2*i] - 'A', lo = src[2*i+1] - 'A';
+        invalid |= hi | lo; // any of upper bits is set for characters outside 'A'-'P'
+        dst[i] = hi << 4 | lo;
+    }
+
+    return (invalid & ~MASK) != 0;
+}
+
+#ifdef B16_X86
+
+__attribute__((target("sse2")))
+static void b16_encode_sse2(char *dst, char const *src, size_t n) {
+    __m128i const mask = _mm_set1_epi8(MASK), a = _mm_set1_epi8('A');
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i const in = _mm_loadu_si128((__m128i const *) (src + i));
+        __m128i const hi = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+        __m128i const lo = _mm_and_si128(in, mask);
+        // Interleave high and low nibbles of every byte
+        _mm_storeu_si128((__m128i *) (dst + 2*i), _mm_add_epi8(_mm_unpacklo_epi8(hi, lo), a));
+        _mm_storeu_si128((__m128i *) (dst + 2*i + 16), _mm_add_epi8(_mm_unpackhi_epi8(hi, lo), a));
+    }
+
+    b16_encode_scalar(dst + 2*i, src + i, n - i);
 }
 
-void b16_decode(char *dst, char const *src, size_t n) {
-    if (n % 2)
-        n--;
-    for (int i = 0; i < n/2; i++)
-        *(dst+i) = (*(src+i*2)-'A')<<4 | *(src+i*2+1)-'A';
-}
\ No newline at end of file
+/**
+ * Decodes 16 pairs of characters (loaded in 'a' and 'b'), accumulates their validity into 'invalid'.
+ */
+__attribute__((target("sse2")))
+static inline __m128i b16_decode_sse2_block(__m128i a, __m128i b, __m128i *const invalid) {
+    __m128i const base = _mm_set1_epi8('A'), upper = _mm_set1_epi8(~MASK), low_byte = _mm_set1_epi16(0x00FF);
+
+    a = _mm_sub_epi8(a, base);
+    b = _mm_sub_epi8(b, base);
+    *invalid = _mm_or_si128(*invalid, _mm_and_si128(_mm_or_si128(a, b), upper));
+    // Every 16-bit word holds high nibble in its low byte and low nibble in its high byte
+    a = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(a, low_byte), 4), _mm_srli_epi16(a, 8));
+    b = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b, low_byte), 4), _mm_srli_epi16(b, 8));
+
+    return _mm_packus_epi16(a, b);
+}
+
+__attribute__((target("sse2")))
+static int b16_decode_sse2(char *dst, char const *src, size_t n) {
+    __m128i invalid = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m128i const a = _mm_loadu_si128((__m128i const *) (src + i));
+        __m128i const b = _mm_loadu_si128((__m128i const *) (src + i + 16));
+        _mm_storeu_si128((__m128i *) (dst + i/2), b16_decode_sse2_block(a, b, &invalid));
+    }
+
+    int const vector_invalid = _mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xFFFF;
+    return b16_decode_scalar(dst + i/2, src + i, n - i) | vector_invalid;
+}
+
+__attribute__((target("avx2")))
+static void b16_encode_avx2(char *dst, char const *src, size_t n) {
+    __m256i const mask = _mm256_set1_epi8(MASK), a = _mm256_set1_epi8('A');
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i const in = _mm256_loadu_si256((__m256i const *) (src + i));
+        __m256i const hi = _mm256_and_si256(_mm256_srli_epi16(in, 4), mask);
+        __m256i const lo = _mm256_and_si256(in, mask);
+        // Unpacking works within 128-bit lanes, so lanes are reordered afterwards
+        __m256i const first = _mm256_add_epi8(_mm256_unpacklo_epi8(hi, lo), a);
+        __m256i const second = _mm256_add_epi8(_mm256_unpackhi_epi8(hi, lo), a);
+        _mm256_storeu_si256((__m256i *) (dst + 2*i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i *) (dst + 2*i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+
+    _mm256_zeroupper(); // avoids penalty of switching to SSE instructions of tail
+    b16_encode_sse2(dst + 2*i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int b16_decode_avx2(char *dst, char const *src, size_t n) {
+    __m256i const base = _mm256_set1_epi8('A'), upper = _mm256_set1_epi8(~MASK), low_byte = _mm256_set1_epi16(0x00FF);
+    __m256i invalid = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 64 <= n; i += 64) {
+        __m256i a = _mm256_sub_epi8(_mm256_loadu_si256((__m256i const *) (src + i)), base);
+        __m256i b = _mm256_sub_epi8(_mm256_loadu_si256((__m256i const *) (src + i + 32)), base);
+        invalid = _mm256_or_si256(invalid, _mm256_and_si256(_mm256_or_si256(a, b), upper));
+        a = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(a, low_byte), 4), _mm256_srli_epi16(a, 8));
+        b = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(b, low_byte), 4), _mm256_srli_epi16(b, 8));
+        // Packing works within 128-bit lanes, so 64-bit quarters are reordered afterwards
+        __m256i const packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *) (dst + i/2), packed);
+    }
+
+    int const vector_invalid = !_mm256_testz_si256(invalid, invalid);
+    _mm256_zeroupper(); // avoids penalty of switching to SSE instructions of tail
+    return b16_decode_sse2(dst + i/2, src + i, n - i) | vector_invalid;
+}
+
+#endif
+
+static void b16_encode_resolve(char *dst, char const *src, size_t n) {
+    void (*impl)(char *, char const *, size_t) = b16_encode_scalar;
+#ifdef B16_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl = b16_encode_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        impl = b16_encode_sse2;
+    }
+#endif
+    b16_encode_impl = impl; // every thread resolves the same implementation, so concurrent first calls are harmless
+    impl(dst, src, n);
+}
+
+static int b16_decode_resolve(char *dst, char const *src, size_t n) {
+    int (*impl)(char *, char const *, size_t) = b16_decode_scalar;
+#ifdef B16_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl = b16_decode_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        impl = b16_decode_sse2;
+    }
+#endif
+    b16_decode_impl = impl; // every thread resolves the same implementation, so concurrent first calls are harmless
+    return impl(dst, src, n);
+}
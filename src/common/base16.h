@@ -38,11 +38,14 @@ void b16_encode(char *dst, char const *src, size_t n);
  *
  * 'dst' and 'src' can overlap on physical memory IF 'src' >= 'dst' - 1
  *
+ * All 'n'/2 bytes are always decoded, characters outside 'A'-'P' only make the result invalid.
+ *
  * @param dst Pointer pointing to character array into which decoded array will be saved.
  * @param src Pointer pointing to character array to be decoded.
  * @param n Number of 'src' bytes to be decoded (buffer size).
+ * @return Zero if all decoded characters were from 'A'-'P' character set, non-zero otherwise.
  */
-void b16_decode(char *dst, char const *src, size_t n);
+int b16_decode(char *dst, char const *src, size_t n);
 
 // END GUARD
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Base32 encoding and decoding.
+ */
+
+#define MASK 0b00011111
+
+/// Value of character outside of alphabet in decoding table
+#define INVALID 0xFF
+
+#include <stdlib.h>
+
+#include "base32.h"
+
+/// Encoding alphabet
+static char const alphabet[] = "0123456789abcdefghijklmnopqrstuv";
+
+/**
+ * Decoding table indexed by character, both cases of letters are accepted. Ranges of characters outside of alphabet
+ * are listed explicitly, so no entry is initialized twice.
+ */
+static unsigned char const table[256] = {
+    [0 ... '0' - 1] = INVALID, ['9' + 1 ... 'A' - 1] = INVALID, ['V' + 1 ... 'a' - 1] = INVALID, ['v' + 1 ... 255] = INVALID,
+    ['0'] = 0, ['1'] = 1, ['2'] = 2, ['3'] = 3, ['4'] = 4, ['5'] = 5, ['6'] = 6, ['7'] = 7, ['8'] = 8, ['9'] = 9,
+    ['a'] = 10, ['b'] = 11, ['c'] = 12, ['d'] = 13, ['e'] = 14, ['f'] = 15, ['g'] = 16, ['h'] = 17, ['i'] = 18,
+    ['j'] = 19, ['k'] = 20, ['l'] = 21, ['m'] = 22, ['n'] = 23, ['o'] = 24, ['p'] = 25, ['q'] = 26, ['r'] = 27,
+    ['s'] = 28, ['t'] = 29, ['u'] = 30, ['v'] = 31,
+    ['A'] = 10, ['B'] = 11, ['C'] = 12, ['D'] = 13, ['E'] = 14, ['F'] = 15, ['G'] = 16, ['H'] = 17, ['I'] = 18,
+    ['J'] = 19, ['K'] = 20, ['L'] = 21, ['M'] = 22, ['N'] = 23, ['O'] = 24, ['P'] = 25, ['Q'] = 26, ['R'] = 27,
+    ['S'] = 28, ['T'] = 29, ['U'] = 30, ['V'] = 31,
+};
+
+size_t b32_encode(char *dst, char const *src, size_t n) {
+    unsigned char const *const in = (unsigned char const *) src;
+    size_t i = 0, o = 0;
+
+    // Whole groups of 5 bytes (40 bits)
+    for (; i + 5 <= n; i += 5) {
+        unsigned long long const group = (unsigned long long) in[i] << 32 | (unsigned long long) in[i+1] << 24 |
+                                         (unsigned long long) in[i+2] << 16 | (unsigned long long) in[i+3] << 8 | in[i+4];
+        for (int shift = 35; shift >= 0; shift -= 5) {
+            dst[o++] = alphabet[group >> shift & MASK];
+        }
+    }
+
+    // Rest of bytes, last character is padded with zero bits
+    unsigned bits = 0, buffer = 0;
+    for (; i < n; i++) {
+        buffer = buffer << 8 | in[i];
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            dst[o++] = alphabet[buffer >> bits & MASK];
+        }
+    }
+    if (bits) {
+        dst[o++] = alphabet[buffer << (5 - bits) & MASK];
+    }
+
+    return o;
+}
+
+long b32_decode(char *dst, char const *src, size_t n) {
+    unsigned char const *const in = (unsigned char const *) src;
+    unsigned char invalid = 0;
+    size_t i = 0, o = 0;
+
+    // Lengths 1, 3 and 6 (modulo 8) are never produced by encoding
+    if (n % 8 == 1 || n % 8 == 3 || n % 8 == 6) {
+        return -1;
+    }
+
+    // Whole groups of 8 characters (40 bits)
+    for (; i + 8 <= n; i += 8) {
+        unsigned long long group = 0;
+        for (int j = 0; j < 8; j++) {
+            unsigned char const value = table[in[i+j]];
+            invalid |= value; // INVALID has upper bits set
+            group = group << 5 | (value & MASK);
+        }
+        dst[o++] = (char) (group >> 32);
+        dst[o++] = (char) (group >> 24);
+        dst[o++] = (char) (group >> 16);
+        dst[o++] = (char) (group >> 8);
+        dst[o++] = (char) group;
+    }
+
+    // Rest of characters, padding bits of last character are dropped
+    unsigned bits = 0, buffer = 0;
+    for (; i < n; i++) {
+        unsigned char const value = table[in[i]];
+        invalid |= value;
+        buffer = buffer << 5 | (value & MASK);
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            dst[o++] = (char) (buffer >> bits);
+        }
+    }
+
+    return invalid & ~MASK ? -1 : (long) o;
+}
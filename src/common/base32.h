@@ -0,0 +1,47 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Base32 encoding and decoding.
+ * @details header file
+ */
+
+// GUARD
+#ifndef B32_H
+#define B32_H
+
+#include <stdlib.h>
+
+/**
+ * Function encodes 'n' bytes of character array pointed by 'src' into character array pointed by 'dst' with base32
+ * encoding (extended hex alphabet of RFC 4648 in lower case, without padding). Used characters to encode are '0'-'9'
+ * and 'a'-'v', which are valid in DNS labels.
+ *
+ * Every 5 bytes are encoded into 8 characters, hence there will be ceil(8*'n'/5) bytes saved into 'dst'.
+ *
+ * @param dst Pointer pointing to character array into which encoded array will be saved.
+ * @param src Pointer pointing to character array to be encoded.
+ * @param n Number of 'src' bytes to be encoded (buffer size).
+ * @return Number of bytes saved into 'dst'.
+ */
+size_t b32_encode(char *dst, char const *src, size_t n);
+
+/**
+ * Function decodes 'n' bytes of character array pointed by 'src' into character array pointed by 'dst' with base32
+ * decoding. Decoding is case-insensitive, as DNS names are (resolvers are allowed to change case of letters).
+ *
+ * Every 8 characters are decoded into 5 bytes, hence there will be floor(5*'n'/8) bytes saved into 'dst'. Bits of
+ * incomplete last byte are ignored.
+ *
+ * 'dst' and 'src' can overlap on physical memory IF 'src' >= 'dst'
+ *
+ * @param dst Pointer pointing to character array into which decoded array will be saved.
+ * @param src Pointer pointing to character array to be decoded.
+ * @param n Number of 'src' bytes to be decoded (buffer size).
+ * @return Number of bytes saved into 'dst', or -1 if 'src' contains character outside of alphabet or 'n' is not
+ * length of any encoded array.
+ */
+long b32_decode(char *dst, char const *src, size_t n);
+
+// END GUARD
+#endif
@@ -0,0 +1,51 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Codecs encoding data into characters valid in DNS labels.
+ */
+
+#include <string.h>
+
+#include "codec.h"
+#include "base16.h"
+#include "base32.h"
+
+/**
+ * Adapters of base16 functions to codec interface.
+ */
+static size_t base16_encode(char *dst, char const *src, size_t n);
+static long base16_decode(char *dst, char const *src, size_t n);
+
+/// All codecs, indexed by their identifiers
+static struct codec const codecs[] = {
+    {"base16", CODEC_BASE16, 4, 2, base16_encode, base16_decode},
+    {"base32", CODEC_BASE32, 5, 8, b32_encode, b32_decode},
+};
+
+
+static size_t base16_encode(char *dst, char const *src, size_t n) {
+    b16_encode(dst, src, n);
+    return n * 2;
+}
+
+static long base16_decode(char *dst, char const *src, size_t n) {
+    return n % 2 || b16_decode(dst, src, n) ? -1 : (long) n / 2;
+}
+
+struct codec const *codec_by_name(char const *const name) {
+    for (unsigned i = 0; i < sizeof(codecs) / sizeof(*codecs); i++) {
+        if (!strcmp(codecs[i].name, name)) {
+            return codecs + i;
+        }
+    }
+    return NULL;
+}
+
+struct codec const *codec_by_id(unsigned char const id) {
+    return id < sizeof(codecs) / sizeof(*codecs) ? codecs + id : NULL;
+}
+
+size_t codec_capacity(struct codec const *const codec, size_t const chars) {
+    return chars * codec->bits / 8;
+}
@@ -0,0 +1,70 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Codecs encoding data into characters valid in DNS labels.
+ * @details header file
+ *
+ * Codec of session is chosen by sender and announced by hello, which (as well as legacy path packet) is always encoded
+ * with base16, so receiver can decode it before knowing codec of session.
+ */
+
+// GUARD
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stdlib.h>
+
+/// Identifiers of codecs carried by hello
+#define CODEC_BASE16 0
+#define CODEC_BASE32 1
+
+/// Codec of labels
+struct codec {
+    char const *name; // name used by command line option
+    unsigned char id; // CODEC_* identifier
+    unsigned char bits; // number of data bits carried by one character
+    unsigned char group; // number of characters decoded independently (encoded data can be split at its multiples)
+
+    /**
+     * Encodes 'n' bytes of 'src' into 'dst'.
+     *
+     * @return Number of characters saved into 'dst'.
+     */
+    size_t (*encode)(char *dst, char const *src, size_t n);
+
+    /**
+     * Decodes 'n' characters of 'src' into 'dst' ('dst' can be the same as 'src').
+     *
+     * @return Number of bytes saved into 'dst', or -1 if 'src' is not valid encoded array.
+     */
+    long (*decode)(char *dst, char const *src, size_t n);
+};
+
+/**
+ * Finds codec by its name.
+ *
+ * @param name Name of codec.
+ * @return Codec, or NULL if there is no codec of such name.
+ */
+struct codec const *codec_by_name(char const *const name);
+
+/**
+ * Finds codec by its identifier.
+ *
+ * @param id Identifier of codec.
+ * @return Codec, or NULL if there is no codec with such identifier.
+ */
+struct codec const *codec_by_id(unsigned char const id);
+
+/**
+ * Returns maximum number of bytes, which are encoded into at most 'chars' characters.
+ *
+ * @param codec Codec.
+ * @param chars Number of characters.
+ * @return Number of bytes.
+ */
+size_t codec_capacity(struct codec const *const codec, size_t const chars);
+
+// END GUARD
+#endif
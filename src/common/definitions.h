@@ -10,15 +10,22 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
-/// DNS port number
-#define PORT 53
-
 /**
  * Maximum length of DNS packet used by this application.
  *
  * 2 (TCP length) + 12 (header) + 255 (max question name in DNS encoded form) + 4 (question tail) */
 #define DNS_MAX_PACKET 273
 
+/// Maximum number of questions carried by one DNS packet
+#define DNS_MAX_QUESTIONS 16
+
+/**
+ * Maximum length of DNS packet carrying more questions (every question following the first one is at most as long as
+ * the first one, its name ends with compression pointer to base host of the first one instead).
+ *
+ * 273 (packet with one question) + 15 * (255 + 4) (next questions) */
+#define DNS_MAX_MESSAGE (DNS_MAX_PACKET + (DNS_MAX_QUESTIONS - 1) * (DNS_MAX_PACKET - DNS_TCP - DNS_HEADER))
+
 /// Maximum length of DNS name part of question in its textual form
 #define DNS_MAX_NAME 253
 
@@ -34,12 +41,21 @@
 /// Length of tail of DNS question part (type and class)
 #define DNS_TAIL 4
 
+/// Upper bits of length byte marking compression pointer in DNS name (RFC 1035, section 4.1.4)
+#define DNS_POINTER 0xC0
+
 /// Maximum dots inserted to split data into labels
 #define MAX_DOTS 4
 
+/// Timeout in seconds for sending and receiving data on connection
+#define SOCKET_TIMEOUT 6
+
 /// Maximum count of default name servers that client will try to connect to
 #define MAX_NAME_SERVERS 10
 
+/// Maximum count of parallel connections of client transferring one file
+#define MAX_CONNECTIONS 64
+
 /// Maximum length of IPv4 address in its textual form (termination byte included)
 #define MAX_IPv4_LENGTH 16
 
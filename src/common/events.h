@@ -11,9 +11,20 @@
 #define EVENTS_H
 
 
+#include "log.h"
+
 #define ACTIVE 1
 #define INACTIVE 0
 
+/// Event hooks are compiled out of build defining NO_EVENTS ('make fast'), then no event is ever handled
+#ifdef NO_EVENTS
+#define EVENT(hook) ((void) 0)
+#define EVENT_CHUNKS(event) 0
+#else
+#define EVENT(hook) (hook)
+#define EVENT_CHUNKS(event) ((event)->active && log_enabled(LOG_DEBUG))
+#endif
+
 /**
  * Used to handle events.
  *
@@ -22,6 +33,9 @@
  * For more information see headers:
  *  "src/sender/dns_sender_events.h"
  *  "src/receiver/dns_receiver_events.h"
+ *
+ * Hooks are called through 'EVENT()', which drops them from build without events. Textual data of chunk events is
+ * produced only if 'EVENT_CHUNKS()' holds (event is active and chunks are logged).
  */
 struct event {
     int active; // ACTIVE/INACTIVE
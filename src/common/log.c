@@ -0,0 +1,357 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Asynchronous log of events (per-thread lock-free rings drained by logger thread).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "log.h"
+#include "err.h"
+
+/// Event in ring, followed by its path and data (record is padded to multiple of 8 bytes)
+struct log_record {
+    unsigned len; // length of record including strings and padding
+    int kind; // LOG_* kind of event
+    int family; // address family, zero if event has no address
+    int chunk_id; // identifier of chunk
+    int size; // size of chunk or of file
+    unsigned short path_len; // length of path
+    unsigned short data_len; // length of data
+    unsigned char addr[16]; // address (IPv4 address takes first 4 bytes)
+};
+
+/// Ring of one thread, written only by its thread and read only by thread draining rings
+struct log_ring {
+    unsigned long long head; // number of bytes ever written (stored by producer with release)
+    unsigned long long tail; // number of bytes ever read (stored by consumer with release)
+    struct log_ring *next; // next ring in list of all rings
+    char buf[LOG_RING]; // records
+};
+
+/// State of log shared by all threads (only thread holding 'drain' formats records into 'out')
+static struct {
+    struct log_ring *rings; // list of rings of all threads (new rings are prepended atomically)
+    int level; // level of log
+    int started; // non-zero if logger thread runs
+    int registered; // non-zero if exit and fork handlers are registered
+    pthread_t thread; // logger thread
+    pthread_mutex_t drain; // held by thread draining rings
+    pthread_mutex_t lock; // lock of condition
+    pthread_cond_t wake; // wakes logger thread before its interval expires
+    char out[LOG_BUF]; // formatted lines
+    unsigned out_len; // length of formatted lines
+} logger = {.level = LOG_DEBUG, .drain = PTHREAD_MUTEX_INITIALIZER, .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER};
+
+/// Ring of calling thread, NULL until it logs the first event
+static __thread struct log_ring *log_ring;
+
+/**
+ * Allocates ring of calling thread and adds it to list of all rings.
+ *
+ * @return Ring.
+ */
+static struct log_ring *log_register(void);
+
+/**
+ * Starts logger thread, if it does not run yet (the first call also registers exit and fork handlers).
+ */
+static void log_start(void);
+
+/**
+ * Body of logger thread, drains rings whenever it is woken or LOG_INTERVAL expires.
+ *
+ * @param arg Unused.
+ * @return Never returns.
+ */
+static void *log_thread(void *const arg);
+
+/**
+ * Formats all records of all rings and writes them (caller holds 'drain').
+ */
+static void log_drain(void);
+
+/**
+ * Formats record into buffer of lines, buffer is written first if it could not hold it.
+ *
+ * @param record Record.
+ * @param path Path of event.
+ * @param data Data of event.
+ */
+static void log_format(struct log_record const *const record, char const *const path, char const *const data);
+
+/**
+ * Writes buffer of lines to standard error output.
+ */
+static void log_write(void);
+
+/**
+ * Copies data into ring at position (wrapping around its end).
+ *
+ * @param ring Ring.
+ * @param pos Position (number of bytes ever written before data).
+ * @param data Data.
+ * @param len Length of data.
+ */
+static void log_ring_write(struct log_ring *const ring, unsigned long long const pos, void const *const data, unsigned const len);
+
+/**
+ * Copies data out of ring from position (wrapping around its end).
+ *
+ * @param ring Ring.
+ * @param pos Position (number of bytes ever read before data).
+ * @param data Buffer of data.
+ * @param len Length of data.
+ */
+static void log_ring_read(struct log_ring const *const ring, unsigned long long const pos, void *const data, unsigned const len);
+
+/**
+ * Locks log before fork, so child does not inherit lock held by logger thread.
+ */
+static void log_fork_prepare(void);
+
+/**
+ * Unlocks log after fork in parent.
+ */
+static void log_fork_parent(void);
+
+/**
+ * Unlocks log after fork in child, drops events inherited from parent (parent writes them) and lets the next event
+ * start logger thread of child.
+ */
+static void log_fork_child(void);
+
+
+void log_level(int const level) {
+    logger.level = level;
+}
+
+int log_parse(char const *const name) {
+    return !strcmp(name, "debug") ? LOG_DEBUG : !strcmp(name, "info") ? LOG_INFO : !strcmp(name, "off") ? LOG_OFF : -1;
+}
+
+int log_enabled(int const level) {
+    return level >= logger.level && level != LOG_OFF;
+}
+
+void log_event(int const kind, int const family, void const *const addr, char const *const path, int const chunk_id, int const size, char const *const data) {
+    struct log_record record;
+
+    if (!log_enabled(kind >= LOG_INIT ? LOG_INFO : LOG_DEBUG)) {
+        return;
+    }
+    if (!log_ring) {
+        log_ring = log_register();
+    }
+    log_start();
+
+    // Missing strings are logged the same way as by printf()
+    char const *const path_str = path ? path : "(null)";
+    char const *const data_str = data ? data : "(null)";
+    size_t const path_len = strlen(path_str), data_len = strlen(data_str);
+    record.kind = kind;
+    record.family = family;
+    record.chunk_id = chunk_id;
+    record.size = size;
+    record.path_len = path_len < LOG_MAX_STRING ? path_len : LOG_MAX_STRING;
+    record.data_len = data_len < LOG_MAX_STRING ? data_len : LOG_MAX_STRING;
+    record.len = (sizeof(struct log_record) + record.path_len + record.data_len + 7) & ~7U;
+    if (family) {
+        memcpy(record.addr, addr, family == AF_INET6 ? 16 : 4);
+    }
+
+    // Full ring is waited out (events are not dropped)
+    unsigned long long const head = log_ring->head;
+    while (LOG_RING - (head - __atomic_load_n(&log_ring->tail, __ATOMIC_ACQUIRE)) < record.len) {
+        pthread_cond_signal(&logger.wake);
+        sched_yield();
+    }
+    log_ring_write(log_ring, head, &record, sizeof(struct log_record));
+    log_ring_write(log_ring, head + sizeof(struct log_record), path_str, record.path_len);
+    log_ring_write(log_ring, head + sizeof(struct log_record) + record.path_len, data_str, record.data_len);
+    __atomic_store_n(&log_ring->head, head + record.len, __ATOMIC_RELEASE);
+
+    // Logger is woken early only when ring is half full, otherwise it drains ring after its interval
+    if (head + record.len - __atomic_load_n(&log_ring->tail, __ATOMIC_ACQUIRE) > LOG_RING / 2) {
+        pthread_cond_signal(&logger.wake);
+    }
+}
+
+void log_flush(void) {
+    pthread_mutex_lock(&logger.drain);
+    log_drain();
+    pthread_mutex_unlock(&logger.drain);
+}
+
+static struct log_ring *log_register(void) {
+    struct log_ring *const ring = calloc(1, sizeof(struct log_ring));
+
+    if (!ring) {
+        err_handle("failed to allocate ring of log", EXIT);
+    }
+    ring->next = __atomic_load_n(&logger.rings, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&logger.rings, &ring->next, ring, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+
+    return ring;
+}
+
+static void log_start(void) {
+    int expected = 0;
+
+    if (__atomic_load_n(&logger.started, __ATOMIC_ACQUIRE) ||
+        !__atomic_compare_exchange_n(&logger.started, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    if (!logger.registered) {
+        logger.registered = 1;
+        atexit(log_flush);
+        pthread_atfork(log_fork_prepare, log_fork_parent, log_fork_child);
+    }
+    if ((errno = pthread_create(&logger.thread, NULL, log_thread, NULL))) {
+        err_handle("logger thread creation failed", EXIT);
+    }
+    pthread_detach(logger.thread);
+}
+
+static void *log_thread(void *const arg) {
+    struct timespec deadline;
+    (void) arg;
+
+    for (;;) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LOG_INTERVAL * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&logger.lock);
+        pthread_cond_timedwait(&logger.wake, &logger.lock, &deadline);
+        pthread_mutex_unlock(&logger.lock);
+
+        log_flush();
+    }
+
+    return NULL;
+}
+
+static void log_drain(void) {
+    struct log_record record;
+    char path[LOG_MAX_STRING + 1], data[LOG_MAX_STRING + 1];
+
+    for (struct log_ring *ring = __atomic_load_n(&logger.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        unsigned long long const head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        unsigned long long tail = ring->tail;
+        while (tail != head) {
+            log_ring_read(ring, tail, &record, sizeof(struct log_record));
+            log_ring_read(ring, tail + sizeof(struct log_record), path, record.path_len);
+            log_ring_read(ring, tail + sizeof(struct log_record) + record.path_len, data, record.data_len);
+            path[record.path_len] = data[record.data_len] = '\0';
+            log_format(&record, path, data);
+            tail += record.len;
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+    log_write();
+}
+
+static void log_format(struct log_record const *const record, char const *const path, char const *const data) {
+    char addr[INET6_ADDRSTRLEN] = "";
+
+    // The longest line holds two strings and few numbers
+    if (LOG_BUF - logger.out_len < 2 * LOG_MAX_STRING + 128) {
+        log_write();
+    }
+    if (record->family) {
+        inet_ntop(record->family, record->addr, addr, INET6_ADDRSTRLEN);
+    }
+
+    char *const line = logger.out + logger.out_len;
+    size_t const space = LOG_BUF - logger.out_len;
+    int len = 0;
+    switch (record->kind) {
+        case LOG_ENCODED:
+            len = snprintf(line, space, "[ENCD] %s %9d '%s'\n", path, record->chunk_id, data);
+            break;
+        case LOG_SENT:
+            len = snprintf(line, space, "[SENT] %s %9d %dB to %s\n", path, record->chunk_id, record->size, addr);
+            break;
+        case LOG_RECEIVED:
+            len = snprintf(line, space, "[RECV] %s %9d %dB from %s\n", path, record->chunk_id, record->size, addr);
+            break;
+        case LOG_PARSED:
+            len = snprintf(line, space, "[PARS] %s '%s'\n", path, data);
+            break;
+        case LOG_INIT:
+            len = snprintf(line, space, "[INIT] %s\n", addr);
+            break;
+        case LOG_COMPLETED:
+            len = snprintf(line, space, "[CMPL] %s of %dB\n", path, record->size);
+            break;
+    }
+    logger.out_len += len;
+}
+
+static void log_write(void) {
+    unsigned written = 0;
+
+    // Log is best effort, lines which cannot be written are dropped
+    while (written < logger.out_len) {
+        ssize_t const ret = write(STDERR_FILENO, logger.out + written, logger.out_len - written);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        written += ret;
+    }
+    logger.out_len = 0;
+    errno = 0;
+}
+
+static void log_ring_write(struct log_ring *const ring, unsigned long long const pos, void const *const data, unsigned const len) {
+    unsigned const offset = pos % LOG_RING;
+    unsigned const first = LOG_RING - offset < len ? LOG_RING - offset : len;
+
+    memcpy(ring->buf + offset, data, first);
+    memcpy(ring->buf, (char const *) data + first, len - first);
+}
+
+static void log_ring_read(struct log_ring const *const ring, unsigned long long const pos, void *const data, unsigned const len) {
+    unsigned const offset = pos % LOG_RING;
+    unsigned const first = LOG_RING - offset < len ? LOG_RING - offset : len;
+
+    memcpy(data, ring->buf + offset, first);
+    memcpy((char *) data + first, ring->buf, len - first);
+}
+
+static void log_fork_prepare(void) {
+    pthread_mutex_lock(&logger.drain);
+    pthread_mutex_lock(&logger.lock);
+}
+
+static void log_fork_parent(void) {
+    pthread_mutex_unlock(&logger.lock);
+    pthread_mutex_unlock(&logger.drain);
+}
+
+static void log_fork_child(void) {
+    for (struct log_ring *ring = logger.rings; ring; ring = ring->next) {
+        ring->tail = ring->head;
+    }
+    logger.out_len = 0;
+    logger.started = 0;
+    pthread_cond_init(&logger.wake, NULL);
+    pthread_mutex_unlock(&logger.lock);
+    pthread_mutex_unlock(&logger.drain);
+}
@@ -0,0 +1,81 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Asynchronous log of events (per-thread lock-free rings drained by logger thread).
+ * @details header file
+ */
+
+// GUARD
+#ifndef LOG_H
+#define LOG_H
+
+/// Log levels (event is logged if its level is at least level of log)
+#define LOG_DEBUG 0 // every chunk
+#define LOG_INFO 1 // starts and ends of transfers
+#define LOG_OFF 2 // nothing
+
+/// Kinds of events, every kind is formatted by logger thread into its own line
+#define LOG_ENCODED 0 // '[ENCD] path chunk 'data''
+#define LOG_SENT 1 // '[SENT] path chunk sizeB to address'
+#define LOG_RECEIVED 2 // '[RECV] path chunk sizeB from address'
+#define LOG_PARSED 3 // '[PARS] path 'data''
+#define LOG_INIT 4 // '[INIT] address'
+#define LOG_COMPLETED 5 // '[CMPL] path of sizeB'
+
+/// Size of ring of one thread in bytes (power of two), thread which fills its ring waits for logger
+#define LOG_RING (1 << 18)
+
+/// Maximum length of string of event (longer one is cut)
+#define LOG_MAX_STRING 1024
+
+/// Size of buffer of formatted lines written by one system call
+#define LOG_BUF (1 << 16)
+
+/// Maximum time in milliseconds for which logged event waits in ring
+#define LOG_INTERVAL 10
+
+/**
+ * Sets level of log.
+ *
+ * @param level LOG_DEBUG, LOG_INFO or LOG_OFF.
+ */
+void log_level(int const level);
+
+/**
+ * Converts name of log level to log level.
+ *
+ * @param name 'debug', 'info' or 'off'.
+ * @return Log level, -1 if name is invalid.
+ */
+int log_parse(char const *const name);
+
+/**
+ * Checks whether events of level are logged.
+ *
+ * @param level Level of event.
+ * @return Non-zero if events of level are logged.
+ */
+int log_enabled(int const level);
+
+/**
+ * Copies event into ring of calling thread (without any system call, unless ring is full), logger thread formats it and
+ * writes it to standard error output later. Logger thread is started by the first event of process.
+ *
+ * @param kind LOG_* kind of event.
+ * @param family Address family of address (AF_INET or AF_INET6), zero if event has no address.
+ * @param addr Address (struct in_addr or struct in6_addr), or NULL.
+ * @param path Path of file, or NULL.
+ * @param chunk_id Identifier of chunk.
+ * @param size Size of chunk or of file in bytes.
+ * @param data Encoded data, or NULL.
+ */
+void log_event(int const kind, int const family, void const *const addr, char const *const path, int const chunk_id, int const size, char const *const data);
+
+/**
+ * Writes all events logged so far (called also at exit of process).
+ */
+void log_flush(void);
+
+// END GUARD
+#endif
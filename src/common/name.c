@@ -0,0 +1,247 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program DNS names carrying encoded data under base host.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "name.h"
+
+/// Maximum length of name in wire format
+#define NAME_MAX_WIRE (DNS_MAX_NAME + 2)
+
+/// Maximum number of characters decoded independently by any codec
+#define NAME_MAX_GROUP 8
+
+/// Length of compression pointer
+#define NAME_POINTER 2
+
+/**
+ * Encodes data into labels of name in wire format (without terminating zero byte).
+ *
+ * @param buf Buffer for labels.
+ * @param data Data to be encoded.
+ * @param data_len Length of data.
+ * @param codec Codec with which data are encoded.
+ * @return Length of labels.
+ */
+static unsigned short name_labels(char *const buf, char const *const data, unsigned short const data_len, struct codec const *const codec);
+
+void base_host_init(struct base_host *const base, char const *const BASE_HOST) {
+    size_t len = strlen(BASE_HOST);
+
+    // Trailing dot of fully qualified name is not part of labels
+    if (len && BASE_HOST[len - 1] == '.') {
+        len--;
+    }
+    memcpy(base->text, BASE_HOST, len);
+    base->text[len] = '\0';
+    base->text_len = len;
+
+    // Wire format, every dot is replaced with length of following label
+    unsigned char label = 0;
+    base->wire_len = len + 2;
+    base->wire[len + 1] = '\0';
+    for (int i = len - 1; i >= -1; i--) {
+        if (i == -1 || BASE_HOST[i] == '.') {
+            base->wire[i + 1] = (char) label;
+            label = 0;
+        } else {
+            base->wire[i + 1] = BASE_HOST[i];
+            label++;
+        }
+    }
+}
+
+unsigned short name_encode(char *const buf, char const *const data, unsigned short const data_len, struct base_host const *const base, struct codec const *const codec) {
+    unsigned short const len = name_labels(buf, data, data_len, codec);
+
+    memcpy(buf + len, base->wire, base->wire_len);
+
+    return len + base->wire_len;
+}
+
+unsigned short name_encode_pointer(char *const buf, char const *const data, unsigned short const data_len, unsigned short const base_offset, struct codec const *const codec) {
+    unsigned short const len = name_labels(buf, data, data_len, codec);
+
+    buf[len] = (char) (DNS_POINTER | base_offset >> 8);
+    buf[len + 1] = (char) base_offset;
+
+    return len + NAME_POINTER;
+}
+
+static unsigned short name_labels(char *const buf, char const *const data, unsigned short const data_len, struct codec const *const codec) {
+    unsigned char const group_bytes = codec->group * codec->bits / 8; // bytes encoded into one group of characters
+    char *label = buf, *out = buf + 1; // length byte of current label and its end
+    unsigned char label_len = 0;
+    char carry[NAME_MAX_GROUP]; // group split between two labels
+    unsigned char carry_len = 0, carry_pos = 0;
+    unsigned short pos = 0;
+
+    while (pos < data_len || carry_pos < carry_len) {
+        // Close full label and start next one
+        if (label_len == DNS_MAX_LABEL) {
+            *label = (char) label_len;
+            label = out++;
+            label_len = 0;
+        }
+        unsigned char const space = DNS_MAX_LABEL - label_len;
+
+        // Rest of split group
+        if (carry_pos < carry_len) {
+            unsigned char const take = carry_len - carry_pos < space ? carry_len - carry_pos : space;
+            memcpy(out, carry + carry_pos, take);
+            out += take;
+            label_len += take;
+            carry_pos += take;
+            continue;
+        }
+
+        // Whole groups fitting into label are encoded in place
+        unsigned short groups = space / codec->group;
+        if (groups > (data_len - pos) / group_bytes) {
+            groups = (data_len - pos) / group_bytes;
+        }
+        if (groups) {
+            unsigned char const n = codec->encode(out, data + pos, groups * group_bytes);
+            out += n;
+            label_len += n;
+            pos += groups * group_bytes;
+            continue;
+        }
+
+        // Group crossing end of label (or last incomplete group) is encoded aside
+        unsigned char const take = data_len - pos < group_bytes ? data_len - pos : group_bytes;
+        carry_len = codec->encode(carry, data + pos, take);
+        carry_pos = 0;
+        pos += take;
+    }
+
+    // Close last label (no label is left for empty data)
+    if (label_len) {
+        *label = (char) label_len;
+    } else {
+        out = label;
+    }
+
+    return out - buf;
+}
+
+void name_text(char *const text, char const *const wire, struct base_host const *const base) {
+    unsigned short pos = 0;
+    unsigned char label_len;
+
+    while ((label_len = wire[pos])) {
+        if ((label_len & DNS_POINTER) == DNS_POINTER) {
+            memcpy(text + pos, base->text, base->text_len + 1);
+            return;
+        }
+        memcpy(text + pos, wire + pos + 1, label_len);
+        pos += label_len;
+        text[pos++] = '.';
+    }
+    text[pos ? pos - 1 : 0] = '\0';
+}
+
+int name_decode(char const *const dns, unsigned short const dns_len, unsigned short *const offset, struct base_host const *const base, struct codec const *const codec, char *const buf, char *const text) {
+    unsigned short const start = *offset;
+    unsigned short end = start, data_end;
+    unsigned char label_len;
+
+    // Find end of name by hopping over length bytes and check where base host starts
+    do {
+        if (end >= dns_len || end - start >= NAME_MAX_WIRE) {
+            return -1;
+        }
+        label_len = dns[end];
+        if ((label_len & DNS_POINTER) == DNS_POINTER) { // compression pointer ends name
+            break;
+        }
+        if (label_len > DNS_MAX_LABEL) { // reserved label type
+            return -1;
+        }
+        end += label_len + 1;
+    } while (label_len);
+    if (label_len) {
+        // Pointer has to point back to base host (which ends name of previous question)
+        if (end + NAME_POINTER > dns_len || end - start + base->wire_len > NAME_MAX_WIRE) {
+            return -1;
+        }
+        unsigned short const target = (label_len & ~DNS_POINTER) << 8 | (unsigned char) dns[end + 1];
+        if (target >= start || target + base->wire_len > dns_len || strncasecmp(dns + target, base->wire, base->wire_len)) {
+            return -1;
+        }
+        data_end = end;
+        end += NAME_POINTER;
+    } else {
+        if (end > dns_len || end - start < base->wire_len) {
+            return -1;
+        }
+        data_end = end - base->wire_len;
+        if (strncasecmp(dns + data_end, base->wire, base->wire_len)) {
+            return -1;
+        }
+    }
+
+    // Decode data labels, groups of characters split between labels are joined in 'carry'
+    char carry[NAME_MAX_GROUP];
+    unsigned char carry_len = 0;
+    unsigned short pos = start, text_pos = 0;
+    long decoded = 0, ret;
+    while (pos < data_end) {
+        char const *label = dns + pos + 1;
+        unsigned char len = dns[pos];
+        pos += len + 1;
+        if (pos > data_end) { // base host does not start at label boundary
+            return -1;
+        }
+        if (text) {
+            memcpy(text + text_pos, label, len);
+            text_pos += len;
+            text[text_pos++] = '.';
+        }
+
+        // Complete group started by previous label
+        if (carry_len) {
+            unsigned char const take = len < codec->group - carry_len ? len : codec->group - carry_len;
+            memcpy(carry + carry_len, label, take);
+            carry_len += take;
+            label += take;
+            len -= take;
+            if (carry_len == codec->group) {
+                if ((ret = codec->decode(buf + decoded, carry, carry_len)) < 0) {
+                    return -1;
+                }
+                decoded += ret;
+                carry_len = 0;
+            }
+        }
+
+        // Whole groups are decoded in place of label, the rest is carried to next label
+        unsigned char const whole = len - len % codec->group;
+        if (whole) {
+            if ((ret = codec->decode(buf + decoded, label, whole)) < 0) {
+                return -1;
+            }
+            decoded += ret;
+        }
+        memcpy(carry + carry_len, label + whole, len - whole);
+        carry_len += len - whole;
+    }
+    if (carry_len) { // last (incomplete) group
+        if ((ret = codec->decode(buf + decoded, carry, carry_len)) < 0) {
+            return -1;
+        }
+        decoded += ret;
+    }
+
+    if (text) {
+        memcpy(text + text_pos, base->text, base->text_len + 1);
+    }
+    *offset = end;
+
+    return decoded;
+}
@@ -0,0 +1,89 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program DNS names carrying encoded data under base host.
+ * @details header file
+ */
+
+// GUARD
+#ifndef NAME_H
+#define NAME_H
+
+#include "definitions.h"
+#include "codec.h"
+
+/// Base host in textual and DNS wire format (precomputed once for all packets)
+struct base_host {
+    char text[DNS_MAX_NAME + 1]; // textual form without trailing dot
+    unsigned char text_len; // length of textual form
+    char wire[DNS_MAX_NAME + 2]; // wire format (length prefixed labels, terminating zero byte included)
+    unsigned char wire_len; // length of wire format
+};
+
+/**
+ * Precomputes base host.
+ *
+ * @param base Base host to be filled.
+ * @param BASE_HOST Base host program argument (checked by 'check_host_lex()').
+ */
+void base_host_init(struct base_host *const base, char const *const BASE_HOST);
+
+/**
+ * Encodes data into name of DNS question in wire format in one forward pass. Data are encoded straight into labels of
+ * at most DNS_MAX_LABEL characters (only group of codec split between two labels is encoded aside first), followed by
+ * precomputed base host.
+ *
+ * @param buf Buffer for name of at least DNS_MAX_NAME + 2 bytes.
+ * @param data Data to be encoded.
+ * @param data_len Length of data (encoded data have to fit into DNS_MAX_NAME - 'base->text_len' - MAX_DOTS characters).
+ * @param base Base host.
+ * @param codec Codec with which data are encoded.
+ * @return Length of name in wire format (terminating zero byte included).
+ */
+unsigned short name_encode(char *const buf, char const *const data, unsigned short const data_len, struct base_host const *const base, struct codec const *const codec);
+
+/**
+ * Encodes data into name of DNS question in wire format like 'name_encode()', but base host is replaced with
+ * compression pointer to base host already written in packet (name of the first question).
+ *
+ * @param buf Buffer for name of at least DNS_MAX_NAME + 2 bytes.
+ * @param data Data to be encoded.
+ * @param data_len Length of data (the same limit as of 'name_encode()').
+ * @param base_offset Offset of base host in DNS packet (without TCP length prefix).
+ * @param codec Codec with which data are encoded.
+ * @return Length of name in wire format (compression pointer included).
+ */
+unsigned short name_encode_pointer(char *const buf, char const *const data, unsigned short const data_len, unsigned short const base_offset, struct codec const *const codec);
+
+/**
+ * Converts name in wire format into textual form (labels separated by dots). Compression pointer ending name is
+ * replaced with base host.
+ *
+ * @param text Buffer of at least DNS_MAX_NAME + 1 bytes.
+ * @param wire Name in wire format (built by 'name_encode()' or 'name_encode_pointer()').
+ * @param base Base host.
+ */
+void name_text(char *const text, char const *const wire, struct base_host const *const base);
+
+/**
+ * Decodes data carried by name of DNS question directly from DNS packet. Labels are walked once, each one is decoded
+ * straight into 'buf' (only characters of group split between two labels are joined first).
+ *
+ * Name is rejected if it leaves packet, contains label longer than DNS_MAX_LABEL, does not end with base host (compared
+ * case-insensitively), or its data are not valid for codec. Base host may be replaced with compression pointer, which
+ * has to point backwards to base host (questions following the first one).
+ *
+ * @param dns DNS packet (without TCP length prefix).
+ * @param dns_len Length of DNS packet.
+ * @param offset Offset of name in packet, moved behind name (to tail of question) on success.
+ * @param base Expected base host.
+ * @param codec Codec with which data are encoded.
+ * @param buf Buffer for decoded data of at least DNS_MAX_NAME - 'base->text_len' bytes.
+ * @param text Buffer for textual form of whole name of at least DNS_MAX_NAME + 1 bytes, or NULL if it is not needed.
+ * @return Number of decoded bytes, or -1 if name is malformed.
+ */
+int name_decode(char const *const dns, unsigned short const dns_len, unsigned short *const offset, struct base_host const *const base, struct codec const *const codec, char *const buf, char *const text);
+
+// END GUARD
+#endif
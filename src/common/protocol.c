@@ -0,0 +1,264 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Extended transfer protocol (session header, sequence numbers and acknowledgements) shared by sender and
+ * receiver.
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "protocol.h"
+#include "codec.h"
+
+/// DNS record type TXT
+#define DNS_TYPE_TXT 16
+
+/// DNS class IN
+#define DNS_CLASS_IN 1
+
+/// Length of fixed part of resource record (type, class, TTL, data length)
+#define DNS_RR_FIXED 10
+
+/**
+ * Finds length of first question of DNS message.
+ *
+ * @param dns DNS message (without TCP length prefix).
+ * @param dns_len Length of message.
+ * @return Length of first question (name and tail), or zero if message is malformed.
+ */
+static unsigned short question_len(char const *const dns, unsigned short const dns_len);
+
+/**
+ * Builds header, echoed first question of query and beginning of TXT answer of response.
+ *
+ * @param buf Buffer of at least PROTO_MAX_RESPONSE bytes.
+ * @param query DNS query (without TCP length prefix).
+ * @param query_len Length of query.
+ * @param txt_len Length of TXT character string (without its length byte).
+ * @return Offset of character string data, or zero if query is malformed.
+ */
+static unsigned short response_header(char *const buf, char const *const query, unsigned short const query_len, unsigned char const txt_len);
+
+/**
+ * Finds TXT character string of response built by 'response_header()'.
+ *
+ * @param dns DNS response (without TCP length prefix).
+ * @param dns_len Length of response.
+ * @param txt_len Expected length of character string.
+ * @param kind Expected first character of string ('A' acknowledgement, 'P' progress).
+ * @return Offset of data following first character, or zero if response does not carry such string.
+ */
+static unsigned short response_txt(char const *const dns, unsigned short const dns_len, unsigned char const txt_len, char const kind);
+
+
+unsigned short proto_hello_encode(char *const buf, struct proto_hello const *const hello) {
+    buf[0] = PROTO_MARKER;
+    buf[1] = PROTO_HELLO;
+    buf[2] = PROTO_VERSION;
+    buf[3] = (char) hello->flags;
+    proto_put_seq(buf + 4, hello->id);
+    buf[8] = (char) (hello->chunk_size >> 8);
+    buf[9] = (char) hello->chunk_size;
+    buf[10] = (char) hello->codec;
+    proto_put_offset(buf + PROTO_HELLO_NO_SIZE, hello->size);
+    memcpy(buf + PROTO_HELLO, hello->path, hello->path_len);
+
+    return PROTO_HELLO + hello->path_len;
+}
+
+int proto_hello_decode(char const *const payload, unsigned short const len, struct proto_hello *const hello) {
+    memset(hello, 0, sizeof(struct proto_hello));
+
+    // Legacy path packet
+    if (!len || *payload != PROTO_MARKER) {
+        hello->path = payload;
+        hello->path_len = len;
+        return !len;
+    }
+
+    // Header is versioned by its length, so newer senders might append fields unknown to this receiver
+    if (len < PROTO_HELLO_MIN) {
+        return 1;
+    }
+    unsigned char const header_len = payload[1];
+    if (header_len < PROTO_HELLO_MIN || header_len > len || payload[2] != PROTO_VERSION) {
+        return 1;
+    }
+    hello->flags = payload[3];
+    hello->id = proto_get_seq(payload + 4);
+    hello->chunk_size = (unsigned char) payload[8] << 8 | (unsigned char) payload[9];
+    hello->codec = header_len > PROTO_HELLO_MIN ? payload[PROTO_HELLO_MIN] : CODEC_BASE16;
+    if (header_len >= PROTO_HELLO) {
+        hello->size = proto_get_offset(payload + PROTO_HELLO_NO_SIZE);
+    } else if (hello->flags & PROTO_FLAG_SIZE) { // size is announced, but not carried
+        return 1;
+    }
+    hello->path = payload + header_len;
+    hello->path_len = len - header_len;
+
+    return !hello->path_len || !hello->chunk_size;
+}
+
+void proto_put_seq(char *const buf, unsigned const seq) {
+    unsigned const seq_n = htonl(seq);
+    memcpy(buf, &seq_n, PROTO_SEQ);
+}
+
+unsigned proto_get_seq(char const *const buf) {
+    unsigned seq_n;
+    memcpy(&seq_n, buf, PROTO_SEQ);
+    return ntohl(seq_n);
+}
+
+void proto_put_offset(char *const buf, unsigned long long const offset) {
+    proto_put_seq(buf, offset >> 32);
+    proto_put_seq(buf + 4, offset);
+}
+
+unsigned long long proto_get_offset(char const *const buf) {
+    return (unsigned long long) proto_get_seq(buf) << 32 | proto_get_seq(buf + 4);
+}
+
+static unsigned short question_len(char const *const dns, unsigned short const dns_len) {
+    unsigned short offset = DNS_HEADER;
+    unsigned char label_len;
+
+    while (offset < dns_len && (label_len = dns[offset])) {
+        if ((label_len & DNS_POINTER) == DNS_POINTER) { // name ends with compression pointer
+            offset++;
+            break;
+        }
+        offset += label_len + 1;
+    }
+    offset += 1 + DNS_TAIL; // terminating zero byte (or second byte of pointer) and tail
+
+    return offset > dns_len ? 0 : offset - DNS_HEADER;
+}
+
+unsigned short proto_query_type(char const *const dns, unsigned short const dns_len) {
+    unsigned short const q_len = question_len(dns, dns_len);
+    unsigned short type;
+
+    if (!q_len) {
+        return 0;
+    }
+    memcpy(&type, dns + DNS_HEADER + q_len - DNS_TAIL, sizeof(type));
+
+    return ntohs(type);
+}
+
+unsigned short proto_build_response(char *const buf, char const *const query, unsigned short const query_len, struct proto_ack const *const ack) {
+    unsigned short offset = response_header(buf, query, query_len, PROTO_ACK);
+    if (!offset) {
+        return 0;
+    }
+
+    // TXT character string with acknowledgement
+    buf[offset++] = 'A';
+    buf[offset++] = (char) ack->flags;
+    proto_put_seq(buf + offset, ack->cum);
+    offset += PROTO_SEQ;
+    proto_put_seq(buf + offset, ack->sack >> 32);
+    proto_put_seq(buf + offset + 4, ack->sack);
+    offset += 8;
+
+    return offset;
+}
+
+int proto_parse_response(char const *const dns, unsigned short const dns_len, struct proto_ack *const ack) {
+    unsigned short offset = response_txt(dns, dns_len, PROTO_ACK, 'A');
+    if (!offset) {
+        return 1;
+    }
+
+    memcpy(&ack->id, dns, sizeof(ack->id));
+    ack->flags = dns[offset++];
+    ack->cum = proto_get_seq(dns + offset);
+    offset += PROTO_SEQ;
+    ack->sack = (unsigned long long) proto_get_seq(dns + offset) << 32 | proto_get_seq(dns + offset + 4);
+
+    return 0;
+}
+
+unsigned short proto_build_progress(char *const buf, char const *const query, unsigned short const query_len, struct proto_progress const *const progress) {
+    unsigned short offset = response_header(buf, query, query_len, PROTO_PROGRESS);
+    if (!offset) {
+        return 0;
+    }
+
+    // TXT character string with progress
+    buf[offset++] = 'P';
+    proto_put_offset(buf + offset, progress->committed);
+    offset += PROTO_OFFSET;
+    proto_put_seq(buf + offset, progress->crc);
+    offset += 4;
+
+    return offset;
+}
+
+int proto_parse_progress(char const *const dns, unsigned short const dns_len, struct proto_progress *const progress) {
+    unsigned short const offset = response_txt(dns, dns_len, PROTO_PROGRESS, 'P');
+    if (!offset) {
+        return 1;
+    }
+
+    progress->committed = proto_get_offset(dns + offset);
+    progress->crc = proto_get_seq(dns + offset + PROTO_OFFSET);
+
+    return 0;
+}
+
+static unsigned short response_header(char *const buf, char const *const query, unsigned short const query_len, unsigned char const txt_len) {
+    unsigned short const q_len = question_len(query, query_len);
+    if (!q_len) {
+        return 0;
+    }
+
+    // Header (ID of query is kept)
+    struct dns_header header;
+    memcpy(&header, query, sizeof(struct dns_header));
+    header.qr = 1;
+    header.aa = 1;
+    header.ra = 0;
+    header.rcode = 0;
+    header.q_count = htons(1);
+    header.ans_count = htons(1);
+    header.auth_count = header.add_count = 0;
+    memcpy(buf, &header, sizeof(struct dns_header));
+    unsigned short offset = sizeof(struct dns_header);
+
+    // Echo first question
+    memcpy(buf + offset, query + DNS_HEADER, q_len);
+    offset += q_len;
+
+    // Answer (name is compression pointer to question name) with one TXT character string
+    unsigned short const rr[] = {htons(DNS_POINTER << 8 | DNS_HEADER), htons(DNS_TYPE_TXT), htons(DNS_CLASS_IN), 0, 0, htons(1 + txt_len)};
+    memcpy(buf + offset, rr, sizeof(rr));
+    offset += sizeof(rr);
+    buf[offset++] = (char) txt_len;
+
+    return offset;
+}
+
+static unsigned short response_txt(char const *const dns, unsigned short const dns_len, unsigned char const txt_len, char const kind) {
+    struct dns_header header;
+    unsigned short const q_len = question_len(dns, dns_len);
+
+    if (dns_len < DNS_HEADER || !q_len) {
+        return 0;
+    }
+    memcpy(&header, dns, sizeof(struct dns_header));
+    if (!header.qr || ntohs(header.q_count) != 1 || ntohs(header.ans_count) != 1) {
+        return 0;
+    }
+
+    // Skip answer's name (compression pointer) and fixed part of record
+    unsigned short const offset = DNS_HEADER + q_len + 2 + DNS_RR_FIXED;
+    if (offset + 1 + txt_len > dns_len || (unsigned char) dns[offset] != txt_len || dns[offset + 1] != kind) {
+        return 0;
+    }
+
+    return offset + 2;
+}
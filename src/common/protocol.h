@@ -0,0 +1,236 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Extended transfer protocol (session header, sequence numbers and acknowledgements) shared by sender and
+ * receiver.
+ * @details header file
+ *
+ * Legacy transfer consists of path packet followed by data packets, which are delivered in order by TCP, end of file
+ * is marked by closing of sending side of connection (receiver closes connection once it read the whole file). Extended
+ * transfer starts with hello packet, which carries path together with session header (flags, identifier, chunk size,
+ * codec of following packets), so features not supported by legacy peers can be turned on per session:
+ *
+ *  hello payload:  0x00 | header length | version | flags | id (4) | chunk size (2) | codec | size (8) | path
+ *  chunk payload:  [sequence number (4)] | data                (sequence number present if PROTO_FLAG_SEQ is set)
+ *                  [file offset (8)] | data                    (file offset present if PROTO_FLAG_OFFSET is set)
+ *  end of file:    [sequence number (4)] | [file offset (8)]   (chunk without data, with PROTO_FLAG_SEQ or PROTO_FLAG_FIN)
+ *
+ * Legacy path never starts with zero byte, so both kinds of first packet can be distinguished. Fields are only appended
+ * to header, older headers (shorter, down to PROTO_HELLO_MIN) get default values of missing fields. Hello and legacy
+ * path packet are always encoded with base16, other packets with codec of session. Hello is sent as TXT
+ * query, so it can be recognized also in middle of datagram session, chunks are sent as A queries. File sent over more
+ * TCP connections in parallel is split into ranges, every connection is separate session with PROTO_FLAG_OFFSET and
+ * PROTO_FLAG_SIZE flags, whose chunks are written at their offsets into file of announced size. Session with
+ * PROTO_FLAG_DEFLATE flag carries file compressed by zlib, receiver decompresses data of chunks in order of sequence
+ * numbers (or in order of arrival, if there are none) before writing them. All numbers are in
+ * network byte order. Receiver answers queries of session with PROTO_FLAG_ACK flag by DNS responses carrying
+ * acknowledgement in TXT record:
+ *
+ *  acknowledgement: 'A' | flags | cumulative acknowledgement (4) | selective acknowledgement bitmap (8)
+ *
+ * Cumulative acknowledgement is the lowest sequence number not received yet, bit 'i' of bitmap is set if chunk with
+ * sequence number (cumulative acknowledgement + 1 + i) was received (chunks further ahead are acknowledged only
+ * cumulatively). TCP session with PROTO_FLAG_FIN flag ends by end
+ * of file mark, which receiver answers by acknowledgement with PROTO_ACK_DONE flag once all data of session were
+ * received, so sender closes connection as soon as it reads it. Connection may continue by hello of another file
+ * instead (batch of files), which starts new session in place of the finished one.
+ *
+ * Receiver keeps progress journal of file received by session with PROTO_FLAG_RESUME flag (TCP, size of file is
+ * announced) and answers its hello by DNS response carrying progress of previous transfer of the same file:
+ *
+ *  progress:        'P' | committed bytes (8) | CRC-32 of committed bytes (4)
+ *  resume packet:   file offset (8)                            (first packet after hello, encoded with codec of session)
+ *
+ * Sender compares checksum with the same prefix of its file and continues by resume packet carrying either committed
+ * bytes (prefix is skipped), or zero (file is sent whole). Chunks following it are appended from that offset.
+ */
+
+// GUARD
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "definitions.h"
+
+/// First byte of hello payload
+#define PROTO_MARKER 0
+
+/// Version of extended protocol
+#define PROTO_VERSION 1
+
+/// Length of hello header (before path)
+#define PROTO_HELLO 19
+
+/// Length of the shortest accepted hello header (without codec)
+#define PROTO_HELLO_MIN 10
+
+/// Length of hello header without size of file
+#define PROTO_HELLO_NO_SIZE 11
+
+/// Length of sequence number prefixed to chunk data
+#define PROTO_SEQ 4
+
+/// Length of file offset prefixed to chunk data (and of size of file carried by hello)
+#define PROTO_OFFSET 8
+
+/// Maximum number of chunks in flight (sequence numbers receiver accepts ahead of cumulative acknowledgement)
+#define PROTO_WINDOW 256
+
+/// Number of sequence numbers following cumulative acknowledgement covered by selective acknowledgement bitmap
+#define PROTO_SACK 64
+
+/// Question types of queries
+#define PROTO_TYPE_DATA 1 // A, path packet and chunks
+#define PROTO_TYPE_HELLO 16 // TXT, hello
+
+/// Session flags carried by hello
+#define PROTO_FLAG_SEQ 0x01 // chunks are prefixed with sequence number and end of file is marked by empty chunk
+#define PROTO_FLAG_ACK 0x02 // receiver acknowledges queries by DNS responses
+#define PROTO_FLAG_OFFSET 0x04 // chunks are prefixed with file offset (file is sent over more connections in parallel)
+#define PROTO_FLAG_SIZE 0x08 // hello carries total size of file
+#define PROTO_FLAG_DEFLATE 0x10 // data of chunks form zlib stream of file (size of file is size of decompressed data)
+#define PROTO_FLAG_RESUME 0x20 // hello is answered by progress of file, resume packet follows it
+#define PROTO_FLAG_FIN 0x40 // session without sequence numbers ends by end of file mark, which receiver acknowledges
+
+/// Acknowledgement flags
+#define PROTO_ACK_DONE 0x01 // whole file was received
+
+/// Length of acknowledgement carried by response
+#define PROTO_ACK 14
+
+/// Length of progress carried by response
+#define PROTO_PROGRESS 13
+
+/// Maximum length of DNS response (header, echoed question and answer with acknowledgement)
+#define PROTO_MAX_RESPONSE (DNS_MAX_PACKET + 12 + 1 + PROTO_ACK)
+
+/// Session header carried by hello packet
+struct proto_hello {
+    unsigned char flags; // PROTO_FLAG_* flags
+    unsigned id; // session identifier chosen by sender (distinguishes retransmitted hello from new session)
+    unsigned short chunk_size; // maximum length of chunk data (without sequence number)
+    unsigned char codec; // CODEC_* identifier of codec of packets following hello
+    unsigned long long size; // total size of file, valid with PROTO_FLAG_SIZE flag
+    char const *path; // destination path (not terminated)
+    unsigned short path_len; // length of destination path
+};
+
+/// Acknowledgement carried by response
+struct proto_ack {
+    unsigned char flags; // PROTO_ACK_* flags
+    unsigned cum; // cumulative acknowledgement
+    unsigned long long sack; // selective acknowledgement bitmap
+    unsigned short id; // DNS ID of answered query (network byte order), set only by parsing
+};
+
+/// Progress of file received by previous sessions, carried by response to hello
+struct proto_progress {
+    unsigned long long committed; // length of prefix of file written by receiver
+    unsigned crc; // CRC-32 of prefix
+};
+
+/**
+ * Serializes hello into payload of first packet of session.
+ *
+ * @param buf Buffer of at least PROTO_HELLO + 'hello->path_len' bytes.
+ * @param hello Hello to be serialized.
+ * @return Length of payload.
+ */
+unsigned short proto_hello_encode(char *const buf, struct proto_hello const *const hello);
+
+/**
+ * Parses payload of first packet of session. Payload of legacy path packet is parsed as hello with no flags, whole
+ * payload being path.
+ *
+ * @param payload Payload of first packet.
+ * @param len Length of payload.
+ * @param hello Hello to be filled ('path' points into 'payload').
+ * @return Zero on success, non-zero if payload is malformed.
+ */
+int proto_hello_decode(char const *const payload, unsigned short const len, struct proto_hello *const hello);
+
+/**
+ * Writes sequence number in network byte order.
+ *
+ * @param buf Buffer of at least PROTO_SEQ bytes.
+ * @param seq Sequence number.
+ */
+void proto_put_seq(char *const buf, unsigned const seq);
+
+/**
+ * Reads sequence number in network byte order.
+ *
+ * @param buf Buffer of at least PROTO_SEQ bytes.
+ * @return Sequence number.
+ */
+unsigned proto_get_seq(char const *const buf);
+
+/**
+ * Writes file offset (or size) in network byte order.
+ *
+ * @param buf Buffer of at least PROTO_OFFSET bytes.
+ * @param offset File offset.
+ */
+void proto_put_offset(char *const buf, unsigned long long const offset);
+
+/**
+ * Reads file offset (or size) in network byte order.
+ *
+ * @param buf Buffer of at least PROTO_OFFSET bytes.
+ * @return File offset.
+ */
+unsigned long long proto_get_offset(char const *const buf);
+
+/**
+ * Finds type of first question of DNS query.
+ *
+ * @param dns DNS query (without TCP length prefix).
+ * @param dns_len Length of query.
+ * @return Question type in host byte order, or zero if query is malformed.
+ */
+unsigned short proto_query_type(char const *const dns, unsigned short const dns_len);
+
+/**
+ * Builds DNS response to query, echoing its ID and first question and carrying acknowledgement in TXT answer.
+ *
+ * @param buf Buffer of at least PROTO_MAX_RESPONSE bytes.
+ * @param query DNS query (without TCP length prefix).
+ * @param query_len Length of query.
+ * @param ack Acknowledgement.
+ * @return Length of response, or zero if query is malformed.
+ */
+unsigned short proto_build_response(char *const buf, char const *const query, unsigned short const query_len, struct proto_ack const *const ack);
+
+/**
+ * Parses acknowledgement from DNS response built by 'proto_build_response()'.
+ *
+ * @param dns DNS response (without TCP length prefix).
+ * @param dns_len Length of response.
+ * @param ack Acknowledgement to be filled.
+ * @return Zero on success, non-zero if response is malformed or does not carry acknowledgement.
+ */
+int proto_parse_response(char const *const dns, unsigned short const dns_len, struct proto_ack *const ack);
+
+/**
+ * Builds DNS response to hello, echoing its ID and first question and carrying progress in TXT answer.
+ *
+ * @param buf Buffer of at least PROTO_MAX_RESPONSE bytes.
+ * @param query DNS query with hello (without TCP length prefix).
+ * @param query_len Length of query.
+ * @param progress Progress of file.
+ * @return Length of response, or zero if query is malformed.
+ */
+unsigned short proto_build_progress(char *const buf, char const *const query, unsigned short const query_len, struct proto_progress const *const progress);
+
+/**
+ * Parses progress from DNS response built by 'proto_build_progress()'.
+ *
+ * @param dns DNS response (without TCP length prefix).
+ * @param dns_len Length of response.
+ * @param progress Progress to be filled.
+ * @return Zero on success, non-zero if response is malformed or does not carry progress.
+ */
+int proto_parse_progress(char const *const dns, unsigned short const dns_len, struct proto_progress *const progress);
+
+// END GUARD
+#endif
@@ -5,331 +5,634 @@
  * @Program Server implementation
  */
 
+#define _GNU_SOURCE // accept4()
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/socket.h>
-#include <sys/stat.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
 
-#include "../common/base16.h"
 #include "../common/err.h"
 #include "../common/definitions.h"
 #include "../common/arguments.h"
-#include "dns_receiver_events.h"
-#include "../common/events.h"
+#include "../common/log.h"
+#include "session.h"
+#include "udp.h"
+#include "writer.h"
+#include "uring.h"
+#include "metrics.h"
+
+/// Maximum number of events returned by one epoll_wait() call
+#define MAX_EPOLL_EVENTS 64
+
+/// Maximum number of worker threads
+#define MAX_WORKERS 256
+
+/// Number of entries of submission queue of io_uring engine of worker
+#define URING_ENTRIES 256
+
+/// Number and size of buffers provided to io_uring engine of worker for receiving from TCP sockets
+#define URING_BUFS 256
+#define URING_BUF_SIZE 16384
+
+/// Identifiers of io_uring requests of server sockets (requests of client sockets are identified by their session)
+#define URING_ACCEPT 1
+#define URING_UDP 2
+
+/// Configuration shared (read only) by all workers of server
+struct server_config {
+    struct base_host base; // base host program argument (precomputed)
+    char const *DST_DIRPATH; // destination directory path program argument
+    int uring; // non-zero if io_uring engine is selected
+    unsigned long long direct_size; // minimal size of file written with O_DIRECT, zero if disabled
+    int tcp_sockets[MAX_WORKERS]; // listening TCP socket of every worker (bound before workers start)
+    int udp_sockets[MAX_WORKERS]; // UDP socket of every worker (bound before workers start)
+};
 
 /**
- * Opens iterative server listening on port 53.
+ * Opens server listening on port PORT_NUMBER (both TCP and UDP). Server consists of 'WORKERS' independent workers, each running in its own thread.
  *
  * @param BASE_HOST Base host program argument.
  * @param DST_DIRPATH Destination directory path program argument.
+ * @param BACKLOG Backlog program argument.
+ * @param WORKERS Workers program argument.
+ * @param DIRECT Direct program argument.
+ * @param ENGINE Engine program argument.
+ * @param LOG_LEVEL Log level program argument.
+ * @param METRICS_FILE Metrics file program argument (NULL if not present).
+ * @param PORT_NUMBER Port program argument.
  */
-void server(char const *const BASE_HOST, char const *const DST_DIRPATH);
+void server(char const *const BASE_HOST, char const *const DST_DIRPATH, char const *const BACKLOG, char const *const WORKERS, char const *const DIRECT, char const *const ENGINE, char const *const LOG_LEVEL, char const *const METRICS_FILE, char const *const PORT_NUMBER);
 
 /**
- * Accept incoming TCP client connection and saves received file.
+ * Runs one worker of server, event driven loop serving any number of clients concurrently.
  *
- * Timeout for received data from client is 6 seconds.
+ * Every worker has its own listening TCP socket and UDP socket bound by server with SO_REUSEPORT option (if there are
+ * more workers), so kernel distributes incoming connections and datagrams (by client's address and port) among workers,
+ * and its own sessions, whose files are written by its own writer thread. Workers do not share any mutable data.
  *
- * @param sockfd Server socket file descriptor.
- * @param base_len Length if base host argument string.
- * @param DST_DIRPATH Destination directory path program argument.
+ * @param config Pointer to 'struct server_config'.
+ * @return Never returns.
  */
-void accept_client(int const sockfd, short const base_len, char const *const DST_DIRPATH);
+void *worker(void *const config);
 
 /**
- * Parses arguments of program. If invalid, prints help on standard error and exits program.
+ * Serves sockets of worker by io_uring: connections are accepted by multishot accept, data of every connection are
+ * received by multishot receive into buffers provided to kernel, datagram socket is watched by multishot poll. Worker
+ * thus makes one system call per batch of completions.
  *
- * @param argc 'argc' passed to 'main()' function.
- * @param argv 'argv' passed to 'main()' function.
- * @param BASE_HOST Base host program argument.
- * @param DST_DIRPATH Destination directory path program argument.
+ * @param sockfd Server TCP socket file descriptor.
+ * @param udp Datagram server of worker.
+ * @param writer Writer of worker.
+ * @param cfg Configuration of server.
+ * @return Only if io_uring is not supported by kernel (errno is set).
  */
-void arg_parse(int const argc, char const *const argv[], char const **const BASE_HOST, char const **const DST_DIRPATH);
+void serve_uring(int const sockfd, struct udp_server *const udp, struct writer *const writer, struct server_config const *const cfg);
 
 /**
- * Reads one DNS packet from socket 'connfd' TCP stream and save it's contents into 'dns' buffer, without first two
- * bytes representing length of DNS packet.
+ * Creates session of connection accepted by io_uring engine and starts receiving from it.
  *
  * @param connfd Client's socket file descriptor.
- * @param dns Buffer for DNS packet.
- * @return Returns number of bytes written to buffer 'dns', or zero, if there was no data available (meaning FIN flag
- * was received).
+ * @param uring io_uring instance of worker.
+ * @param buffers Buffers provided for receiving.
+ * @param sessions List of open sessions.
+ * @param writer Writer of worker.
  */
-short receive_dns_packet(int const connfd, char *const dns);
+void uring_accepted(int const connfd, struct uring *const uring, struct uring_buffers const *const buffers, struct session_list *const sessions, struct writer *const writer);
 
 /**
- * Inline function used to customize read() standard function to exit program with error, if read() returns value '-1'.
- * Except this behaviour is function my_reda() equal to function read(), including return value and parameters. For more
- * info on these check man of read().
+ * Processes completion of receive request of session of io_uring engine.
+ *
+ * @param cqe Completion.
+ * @param session Session of request.
+ * @param uring io_uring instance of worker.
+ * @param buffers Buffers provided for receiving.
+ * @param sessions List of open sessions.
+ * @param cfg Configuration of server.
  */
-static inline short my_read(int const fd, void *const buf, int const nbytes);
+void uring_received(struct io_uring_cqe const *const cqe, struct session *const session, struct uring *const uring, struct uring_buffers *const buffers, struct session_list *const sessions, struct server_config const *const cfg);
 
 /**
- * Extract data from DNS packet.
+ * Accepts all pending TCP client connections, creates their sessions and registers them into epoll instance.
  *
- * @param dns DNS packet.
- * @param dns_len Length of DNS packet passed in 'dns' parameter.
- * @param base_len Length if base host argument string.
- * @param buf Buffer to which save extracted data from DNS packet.
- * @return Number of bytes extracted from DNS packet.
+ * @param sockfd Server socket file descriptor.
+ * @param epollfd Epoll instance file descriptor.
+ * @param sessions List of open sessions.
+ * @param writer Writer of worker.
  */
-short disassemble_dns_packet(char const *const dns, short const dns_len, short const base_len, char *const buf);
+void accept_clients(int const sockfd, int const epollfd, struct session_list *const sessions, struct writer *const writer);
 
 /**
- * Attempts to create all directories contained in path.
+ * Creates non-blocking socket bound to port of any address, which might be shared with sockets of other workers.
+ * The first socket of port is bound exclusively (binding fails if port is taken, even by sockets with SO_REUSEPORT),
+ * only then it allows sockets of other workers to join it.
  *
- * @param path_const Path.
+ * @param type Type of socket (SOCK_STREAM or SOCK_DGRAM).
+ * @param port Port.
+ * @param join Non-zero if socket joins the first socket of port (SO_REUSEPORT is set before binding).
+ * @param shared Non-zero if port is shared with sockets of other workers (SO_REUSEPORT is set after binding of the
+ * first socket).
+ * @return Socket file descriptor.
  */
-void create_dirs(char const *const path);
+int bind_socket(int const type, unsigned short const port, int const join, int const shared);
 
+/**
+ * Closes sessions, which did not receive any data for SOCKET_TIMEOUT seconds.
+ *
+ * @param sessions List of open sessions.
+ * @param udp Datagram server of worker (datagram sessions are removed from its table).
+ * @param uring Non-zero if sessions are served by io_uring engine (TCP session is only shut down, it is destroyed when
+ * its receive request ends).
+ */
+void close_idle_sessions(struct session_list *const sessions, struct udp_server *const udp, int const uring);
 
-// Initialize event data structure globally, so it doesn't have to be passed to every function
-struct event event;
+/**
+ * Closes session of io_uring engine removed from list of sessions. TCP session is shut down (its pending receive request
+ * ends and destroys it), datagram session is destroyed at once.
+ *
+ * @param session Session.
+ */
+void uring_close(struct session *const session);
 
+/**
+ * Parses arguments of program. If invalid, prints help on standard error and exits program.
+ *
+ * @param argc 'argc' passed to 'main()' function.
+ * @param argv 'argv' passed to 'main()' function.
+ * @param BASE_HOST Base host program argument.
+ * @param DST_DIRPATH Destination directory path program argument.
+ * @param BACKLOG Pointer to which save BACKLOG optional argument.
+ * @param WORKERS Pointer to which save WORKERS optional argument.
+ * @param DIRECT Pointer to which save DIRECT optional argument.
+ * @param ENGINE Pointer to which save ENGINE optional argument.
+ * @param LOG_LEVEL Pointer to which save LOG_LEVEL optional argument.
+ * @param METRICS_FILE Pointer to which save METRICS_FILE optional argument (NULL if not present).
+ * @param PORT_NUMBER Pointer to which save PORT optional argument.
+ */
+void arg_parse(int const argc, char *const argv[], char const **const BASE_HOST, char const **const DST_DIRPATH, char const **const BACKLOG, char const **const WORKERS, char const **const DIRECT, char const **const ENGINE, char const **const LOG_LEVEL, char const **const METRICS_FILE, char const **const PORT_NUMBER);
 
-int main(int const argc, char const *const argv[]) {
-    // Parse program arguments
-    const char *BASE_HOST, *DST_DIRPATH;
-    arg_parse(argc, argv, &BASE_HOST, &DST_DIRPATH);
-    check_host_lex(BASE_HOST);
+/**
+ * Checks, if values of passed program arguments by user are valid.
+ *
+ * @param BASE_HOST Base host program argument.
+ * @param BACKLOG Backlog program argument.
+ * @param WORKERS Workers program argument.
+ * @param DIRECT Direct program argument.
+ * @param ENGINE Engine program argument.
+ * @param LOG_LEVEL Log level program argument.
+ * @param PORT_NUMBER Port program argument.
+ */
+void arg_check(char const *const BASE_HOST, char const *const BACKLOG, char const *const WORKERS, char const *const DIRECT, char const *const ENGINE, char const *const LOG_LEVEL, char const *const PORT_NUMBER);
+
+
+int main(int const argc, char *const argv[]) {
+    // Parse and check program arguments
+    const char *BASE_HOST, *DST_DIRPATH, *BACKLOG, *WORKERS, *DIRECT, *ENGINE, *LOG_LEVEL, *METRICS_FILE, *PORT_NUMBER;
+    arg_parse(argc, argv, &BASE_HOST, &DST_DIRPATH, &BACKLOG, &WORKERS, &DIRECT, &ENGINE, &LOG_LEVEL, &METRICS_FILE, &PORT_NUMBER);
+    arg_check(BASE_HOST, BACKLOG, WORKERS, DIRECT, ENGINE, LOG_LEVEL, PORT_NUMBER);
 
     // Run server
-    server(BASE_HOST, DST_DIRPATH);
+    server(BASE_HOST, DST_DIRPATH, BACKLOG, WORKERS, DIRECT, ENGINE, LOG_LEVEL, METRICS_FILE, PORT_NUMBER);
 
     return 0;
 }
 
-void server(char const *const BASE_HOST, char const *const DST_DIRPATH) {
-    int sockfd;
-    struct sockaddr_in servaddr;
+void server(char const *const BASE_HOST, char const *const DST_DIRPATH, char const *const BACKLOG, char const *const WORKERS, char const *const DIRECT, char const *const ENGINE, char const *const LOG_LEVEL, char const *const METRICS_FILE, char const *const PORT_NUMBER) {
+    static struct server_config config;
+    int const workers_count = strtol(WORKERS, NULL, 10);
+    pthread_t threads[workers_count];
+
+    base_host_init(&config.base, BASE_HOST);
+    config.DST_DIRPATH = DST_DIRPATH;
+    config.uring = !strcmp(ENGINE, "uring");
+    config.direct_size = strtoull(DIRECT, NULL, 10);
+    log_level(log_parse(LOG_LEVEL));
+
+    /* Sockets of all workers are bound before workers start and the first ones exclusively, so port is never shared
+     * with another running receiver (kernel would silently split clients between them) */
+    unsigned short const port = strtol(PORT_NUMBER, NULL, 10);
+    int const backlog = strtol(BACKLOG, NULL, 10);
+    for (int i = 0; i < workers_count; i++) {
+        config.tcp_sockets[i] = bind_socket(SOCK_STREAM, port, i, workers_count > 1);
+        if ((listen(config.tcp_sockets[i], backlog)) != 0) {
+            err_handle("listen failed", EXIT);
+        }
+        config.udp_sockets[i] = bind_socket(SOCK_DGRAM, port, i, workers_count > 1);
+    }
 
-    // Creating socket file descriptor
-    if ( (sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0 ) {
-        err_handle("socket creation failed", EXIT);
+    // Metrics thread has to be started first, so all other threads block SIGUSR1 accepted by it
+    metrics_start(METRICS_FILE);
+
+    // Only one worker does not need any extra thread
+    if (workers_count == 1) {
+        worker(&config);
     }
 
-    // Filling server information
-    memset(&servaddr, 0, sizeof(servaddr));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servaddr.sin_port = htons(PORT);
+    // Start workers and wait for them (they never end, any fatal error exits whole program)
+    for (int i = 0; i < workers_count; i++) {
+        if ((errno = pthread_create(threads + i, NULL, worker, &config))) {
+            err_handle("worker thread creation failed", EXIT);
+        }
+    }
+    for (int i = 0; i < workers_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
 
-    // Bind
-    if ((bind(sockfd, (struct sockaddr*) &servaddr, sizeof(servaddr))) != 0) {
-        err_handle("socket bind failed", EXIT);
+void *worker(void *const config) {
+    struct server_config const *const cfg = config;
+    int sockfd, epollfd;
+    struct epoll_event ev, events[MAX_EPOLL_EVENTS];
+    struct session_list sessions = {NULL, NULL, 0};
+    static __thread struct udp_server udp; // sessions table is too big for stack
+    static int workers = 0; // number of started workers
+    int const index = __atomic_fetch_add(&workers, 1, __ATOMIC_RELAXED);
+    char name[16];
+
+    snprintf(name, sizeof(name), "worker%d", index);
+    metrics_register(name);
+
+    // Output files of worker are written by its own writer thread, so disk never stalls receiving
+    snprintf(name, sizeof(name), "writer%d", index);
+    struct writer *const writer = writer_start(name, cfg->direct_size, cfg->uring);
+
+    // Sockets of worker were bound by server already
+    sockfd = cfg->tcp_sockets[index];
+    udp_init(&udp, cfg->udp_sockets[index], writer);
+
+    // io_uring engine returns only if kernel does not support it
+    if (cfg->uring) {
+        serve_uring(sockfd, &udp, writer, cfg);
+        err_handle("io_uring is not supported, worker falls back to epoll", WARNING);
     }
 
-    // Listen
-    if ((listen(sockfd, 1)) != 0) {
-        err_handle("listen failed", EXIT);
+    // Register server sockets into epoll instance (identified by NULL session and datagram server)
+    if ((epollfd = epoll_create1(0)) < 0) {
+        err_handle("epoll creation failed", EXIT);
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, sockfd, &ev) != 0) {
+        err_handle("epoll registration of server socket failed", EXIT);
+    }
+    ev.data.ptr = &udp;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, udp.sockfd, &ev) != 0) {
+        err_handle("epoll registration of server socket failed", EXIT);
     }
 
-    // Start accepting incoming connections in infinite loop
-    short const base_len = strlen(BASE_HOST);
+    // Serve incoming connections and data in infinite loop
     for (;;) {
-        // Initialize event
-        event_init(&event);
+        int events_count = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, 1000); // wake up at least every second
+        metrics_count(METRIC_SYSCALLS, 1);
+        if (events_count < 0) {
+            if (errno != EINTR) {
+                err_handle("epoll wait failed", EXIT);
+            }
+            errno = 0;
+            continue;
+        }
+
+        for (int i = 0; i < events_count; i++) {
+            struct session *session = events[i].data.ptr;
+
+            if (!session) { // server TCP socket
+                accept_clients(sockfd, epollfd, &sessions, writer);
+                continue;
+            }
+            if (events[i].data.ptr == &udp) { // server UDP socket
+                udp_receive(&udp, &sessions, &cfg->base, cfg->DST_DIRPATH);
+                continue;
+            }
+
+            session_list_remove(&sessions, session);
+            if (session_receive(session, &cfg->base, cfg->DST_DIRPATH) == SESSION_CLOSED) {
+                session_destroy(session); // closing socket also removes it from epoll instance
+            } else {
+                session_list_append(&sessions, session); // move to most recently active position
+            }
+        }
 
-        // Accept client
-        accept_client(sockfd, base_len, DST_DIRPATH);
+        close_idle_sessions(&sessions, &udp, 0);
     }
 }
 
-void accept_client(int const sockfd, short const base_len, char const *const DST_DIRPATH) {
-    int connfd;
-    char dns[DNS_MAX_PACKET]; // DNS packet buffer
-    char chunk[(DNS_MAX_NAME - base_len - MAX_DOTS) / 2]; // 2 stands for b16 encoding overhead
-    FILE *file;
-    struct sockaddr_in cliaddr;
+void serve_uring(int const sockfd, struct udp_server *const udp, struct writer *const writer, struct server_config const *const cfg) {
+    struct uring uring;
+    struct uring_buffers buffers;
+    struct session_list sessions = {NULL, NULL, 0};
+    struct io_uring_cqe *cqe;
 
-    // Filling client information
-    memset(&cliaddr, 0, sizeof(cliaddr));
+    if (uring_init(&uring, URING_ENTRIES)) {
+        return;
+    }
+    if (uring_buffers_init(&uring, &buffers, 0, URING_BUFS, URING_BUF_SIZE)) {
+        int const err = errno;
+        uring_exit(&uring);
+        errno = err;
+        return;
+    }
+    uring_prep_accept(&uring, sockfd, URING_ACCEPT);
+    uring_prep_poll(&uring, udp->sockfd, URING_UDP);
+
+    // Submit new requests and wait for completions in one system call (wake up at least every second)
+    for (;;) {
+        if (uring_submit(&uring, 1, 1000)) {
+            err_handle("io_uring wait failed", EXIT);
+        }
+
+        while ((cqe = uring_cqe(&uring))) {
+            struct io_uring_cqe const completion = *cqe;
+            uring_seen(&uring);
+            int const more = completion.flags & IORING_CQE_F_MORE; // multishot request continues
+
+            switch (completion.user_data) {
+                case URING_ACCEPT:
+                    if (completion.res >= 0) {
+                        uring_accepted(completion.res, &uring, &buffers, &sessions, writer);
+                    } else if (completion.res != -ECONNABORTED && completion.res != -EINTR) {
+                        errno = -completion.res;
+                        err_handle("accept failed", WARNING);
+                    }
+                    if (!more) {
+                        uring_prep_accept(&uring, sockfd, URING_ACCEPT);
+                    }
+                    break;
+                case URING_UDP:
+                    udp_receive(udp, &sessions, &cfg->base, cfg->DST_DIRPATH);
+                    if (!more) {
+                        uring_prep_poll(&uring, udp->sockfd, URING_UDP);
+                    }
+                    break;
+                default:
+                    uring_received(&completion, (struct session *) completion.user_data, &uring, &buffers, &sessions, cfg);
+            }
+        }
 
-    // Accept
-    unsigned len = sizeof(cliaddr);
-    if ((connfd = accept(sockfd, (struct sockaddr *) &cliaddr, &len)) < 0) {
-        err_handle("accept failed", WARNING);
+        close_idle_sessions(&sessions, udp, 1);
     }
-    event.addr = &cliaddr.sin_addr;
+}
+
+void uring_accepted(int const connfd, struct uring *const uring, struct uring_buffers const *const buffers, struct session_list *const sessions, struct writer *const writer) {
+    struct sockaddr_in cliaddr;
+    struct session *session;
 
-    // Set timeout for receiving
-    struct timeval timeout;
-    timeout.tv_sec = 6;
-    timeout.tv_usec = 0;
-    if (setsockopt(connfd, SOL_SOCKET, SO_RCVTIMEO, &timeout,sizeof(timeout)) < 0) {
-        err_handle("set timeout option of socket failed", WARNING);
+    // Address of client is not passed by multishot accept
+    memset(&cliaddr, 0, sizeof(cliaddr));
+    socklen_t len = sizeof(cliaddr);
+    if (getpeername(connfd, (struct sockaddr *) &cliaddr, &len)) {
+        errno = 0;
     }
 
-    // Get path (into chunk variable)
-    short dns_len = receive_dns_packet(connfd, dns);
-    if (!dns_len) {
+    if (!(session = session_create(connfd, &cliaddr, writer))) {
+        err_handle("failed to allocate session", WARNING);
         close(connfd);
         return;
     }
-    short chunk_len = disassemble_dns_packet(dns, dns_len, base_len, chunk);
-
-    // Concatenate paths
-    short DST_DIRPATH_len = strlen(DST_DIRPATH);
-    char full_path[DST_DIRPATH_len + chunk_len + 2];
-    memcpy(full_path, DST_DIRPATH, DST_DIRPATH_len + 1);
-    if (full_path[DST_DIRPATH_len - 1] != '/' && *chunk != '/')
-        strcat(full_path, "/");
-    chunk[chunk_len] = '\0';
-    strcat(full_path, chunk);
-    event.filePath = full_path;
-
-    // Open (create) file (and possibly directories) for write
-    create_dirs(full_path);
-    if (!(file = fopen(full_path, "wb"))) {
-        char *msg2 = ": failed to open file for write";
-        char msg1[sizeof(full_path) + strlen(msg2)];
-        strcpy(msg1, full_path);
-        strcat(msg1, msg2);
-        err_handle(msg1, WARNING);
-        close(connfd);
+    uring_prep_recv(uring, connfd, buffers->group, (unsigned long) session);
+    session_list_append(sessions, session);
+}
+
+void uring_received(struct io_uring_cqe const *const cqe, struct session *const session, struct uring *const uring, struct uring_buffers *const buffers, struct session_list *const sessions, struct server_config const *const cfg) {
+    // Received data are processed straight from provided buffer, which is then returned to kernel
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        unsigned short const id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (cqe->res > 0 && !session->closing) {
+            metrics_count(METRIC_RECEIVED, cqe->res);
+            session_list_remove(sessions, session);
+            if (session_feed(session, uring_buffer(buffers, id), cqe->res, &cfg->base, cfg->DST_DIRPATH) == SESSION_CLOSED) {
+                uring_close(session);
+            } else {
+                session_list_append(sessions, session); // move to most recently active position
+            }
+        }
+        uring_buffer_recycle(buffers, id);
+    }
+    if (cqe->flags & IORING_CQE_F_MORE) {
         return;
     }
 
-    // Get and write (save) file
-    event.active = ACTIVE;
-    dns_receiver__on_transfer_init(event.addr);
-    while ((dns_len = receive_dns_packet(connfd, dns))) {
-        // Process dns packet and save data
-        chunk_len = disassemble_dns_packet(dns, dns_len, base_len, chunk);
-        if(fwrite(chunk, 1, chunk_len, file) != chunk_len) { // cannot write to file
-            char *msg2 = ": failed to write";
-            char msg1[sizeof(full_path) + strlen(msg2)];
-            strcpy(msg1, full_path);
-            strcat(msg1, msg2);
-            err_handle(msg1, WARNING);
-            close(connfd);
-            fclose(file);
-            dns_receiver__on_transfer_completed(event.filePath, event.fileSize);
-            return;
+    // Receive request ended, it is restarted if it only ran out of buffers (or completion queue)
+    if (!session->closing && (cqe->res > 0 || cqe->res == -ENOBUFS)) {
+        uring_prep_recv(uring, session->connfd, buffers->group, (unsigned long) session);
+        return;
+    }
+    if (!session->closing) { // client closed connection, or error occurred
+        session->eof = !cqe->res;
+        if (cqe->res < 0) {
+            errno = -cqe->res;
+            err_handle("cannot read from client socket", WARNING);
         }
-        dns_receiver__on_chunk_received(event.addr, event.filePath, event.chunkId, chunk_len);
-        event.fileSize += chunk_len;
-        event.chunkId++;
+        session_list_remove(sessions, session);
     }
-
-    // Clean
-    close(connfd);
-    fclose(file);
-    dns_receiver__on_transfer_completed(event.filePath, event.fileSize);
+    session_destroy(session);
 }
 
-void arg_parse(int const argc, char const *const argv[], char const **const BASE_HOST, char const **const DST_DIRPATH) {
-    if (argc != 3) {
-        char const *const msg = "Usage: dns_receiver BASE_HOST DST_DIRPATH";
-        err_handle(msg, EXIT);
+void uring_close(struct session *const session) {
+    if (session->connfd == -1) {
+        session_destroy(session);
+        return;
     }
-    *BASE_HOST = argv[1];
-    *DST_DIRPATH = argv[2];
+    shutdown(session->connfd, SHUT_RDWR);
+    session->closing = 1;
 }
 
-short receive_dns_packet(int const connfd, char *const dns) {
-    short bytes_read, dns_len;
+int bind_socket(int const type, unsigned short const port, int const join, int const shared) {
+    int sockfd;
+    struct sockaddr_in servaddr;
 
-    // Read length of dns packet
-    if ((bytes_read = my_read(connfd, &dns_len, 2)) == 0) { // connection closed with FIN flag
-        return 0;
-    } else if (bytes_read == 1) { // only one out of 2 bytes was read
-        my_read(connfd, ((char *) &dns_len) + 1, 1); // read second byte of prefixed length
+    // Creating socket file descriptor
+    if ( (sockfd = socket(AF_INET, type | SOCK_NONBLOCK, 0)) < 0 ) {
+        err_handle("socket creation failed", EXIT);
     }
-    dns_len = ntohs(dns_len);
 
-    // Read dns packet (without prefixed length)
-    bytes_read = my_read(connfd, dns, dns_len);
-    if (bytes_read != dns_len) { // DNS packet was not read whole from stream
-        short bytes_missing = dns_len - bytes_read;
-        while (bytes_missing) { // read whole DNS packet from stream
-            bytes_missing -= my_read(connfd, dns + dns_len - bytes_missing, bytes_missing);
-        }
+    // Allow rebinding while old connections linger (and every worker to bind its own socket to the same port)
+    int const enable = 1;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0 ||
+        (join && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)) {
+        err_handle("set reuse option of socket failed", EXIT);
     }
 
-    return dns_len;
-}
+    // Filling server information
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    servaddr.sin_port = htons(port);
 
-static inline short my_read(int const fd, void *const buf, int const nbytes) {
-    short read_ret = read(fd, buf, nbytes);
+    // Bind
+    if ((bind(sockfd, (struct sockaddr*) &servaddr, sizeof(servaddr))) != 0) {
+        err_handle("socket bind failed", EXIT);
+    }
 
-    if (read_ret == -1) {
-        err_handle("cannot read from client socket", EXIT);
+    // The first socket of port shared by workers lets others join only after it was bound exclusively
+    if (!join && shared && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+        err_handle("set reuse option of socket failed", EXIT);
     }
 
-    return read_ret;
+    return sockfd;
+}
+
+void accept_clients(int const sockfd, int const epollfd, struct session_list *const sessions, struct writer *const writer) {
+    int connfd;
+    struct sockaddr_in cliaddr;
+    struct session *session;
+    struct epoll_event ev;
+
+    for (;;) {
+        // Filling client information
+        memset(&cliaddr, 0, sizeof(cliaddr));
+
+        // Accept
+        socklen_t len = sizeof(cliaddr);
+        connfd = accept4(sockfd, (struct sockaddr *) &cliaddr, &len, SOCK_NONBLOCK);
+        metrics_count(METRIC_SYSCALLS, 1);
+        if (connfd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { // no more pending connections
+                errno = 0;
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                errno = 0;
+                continue;
+            } else {
+                err_handle("accept failed", WARNING);
+            }
+            return;
+        }
+
+        // Create session and register it into epoll instance
+        if (!(session = session_create(connfd, &cliaddr, writer))) {
+            err_handle("failed to allocate session", WARNING);
+            close(connfd);
+            continue;
+        }
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = session;
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, connfd, &ev) != 0) {
+            err_handle("epoll registration of client socket failed", WARNING);
+            session_destroy(session);
+            continue;
+        }
+        session_list_append(sessions, session);
+    }
 }
 
-short disassemble_dns_packet(char const *const dns, short const dns_len, short const base_len, char *const buf) {
-    // Extract data from packet
-    unsigned short dns_encoded_data_len = dns_len - DNS_HEADER - DNS_TAIL - base_len - 2;
-    char encoded_data[dns_encoded_data_len + 1];
-    encoded_data[dns_encoded_data_len] = '\0';
-    memcpy(encoded_data, dns + DNS_HEADER, dns_encoded_data_len);
-
-    // Handle event
-    if (event.active) {
-        char encoded_data_for_event[dns_encoded_data_len + base_len + 2];
-        char n;
-        int offset = 0;
-        memcpy(encoded_data_for_event, dns + DNS_HEADER, sizeof(encoded_data_for_event));
-        while ((n = *(encoded_data_for_event + offset))) {
-            encoded_data_for_event[offset] = '.';
-            offset += n + 1;
+void close_idle_sessions(struct session_list *const sessions, struct udp_server *const udp, int const uring) {
+    time_t const now = time(NULL);
+
+    // Sessions are ordered by last activity, so only the oldest ones have to be checked
+    while (sessions->head && now - sessions->head->last_active >= SOCKET_TIMEOUT) {
+        struct session *session = sessions->head;
+        session_list_remove(sessions, session);
+        if (session->connfd == -1) {
+            udp_forget(udp, session);
+        }
+        if (session->state != SESSION_DONE) {
+            err_handle("client timed out, closing connection", WARNING);
+        }
+        if (uring) {
+            uring_close(session);
+        } else {
+            session_destroy(session);
         }
-        dns_receiver__on_query_parsed(event.filePath, encoded_data_for_event + 1);
     }
+}
 
-    // DNS decode data (recognize and remove dot character codes) into same buffer
-    unsigned char label_len = *encoded_data, data_len = 0, i = 1;
-    while (label_len) {
-        memmove(encoded_data + data_len, encoded_data + data_len + i, label_len);
-        data_len += label_len;
-        label_len = *(encoded_data + data_len + i++);
+void arg_parse(int const argc, char *const argv[], char const **const BASE_HOST, char const **const DST_DIRPATH, char const **const BACKLOG, char const **const WORKERS, char const **const DIRECT, char const **const ENGINE, char const **const LOG_LEVEL, char const **const METRICS_FILE, char const **const PORT_NUMBER) {
+    int err_flag = 0;
+    char opt;
+    opterr = 0; // mute getopt()'s stderr output global flag
+
+    // Pre-initialize optional arguments
+    *BACKLOG = "128";
+    *WORKERS = "1";
+    *DIRECT = "0";
+    *ENGINE = "epoll";
+    *LOG_LEVEL = "debug";
+    *METRICS_FILE = NULL;
+    *PORT_NUMBER = "53";
+
+    // Options
+    while ((opt = getopt(argc, argv, "b:j:d:i:L:m:p:")) != -1) {
+        switch (opt) {
+            case 'b':
+                *BACKLOG = optarg;
+                break;
+            case 'j':
+                *WORKERS = optarg;
+                break;
+            case 'd':
+                *DIRECT = optarg;
+                break;
+            case 'i':
+                *ENGINE = optarg;
+                break;
+            case 'L':
+                *LOG_LEVEL = optarg;
+                break;
+            case 'm':
+                *METRICS_FILE = optarg;
+                break;
+            case 'p':
+                *PORT_NUMBER = optarg;
+                break;
+            default:
+                err_flag++;
+        }
     }
 
-    // Base16 decode
-    b16_decode(buf, encoded_data, data_len);
+    // Positional arguments
+    if (argc - optind != 2) {
+        err_flag++;
+    } else {
+        *BASE_HOST = argv[optind++];
+        *DST_DIRPATH = argv[optind++];
+    }
 
-    return data_len / 2;
+    if (err_flag) {
+        char const *const msg = "Usage: dns_receiver [options] BASE_HOST DST_DIRPATH\n\nOptions:\n-b BACKLOG\t\tmaximum length of queue of pending connections, integer, >0, default(128)\n-j WORKERS\t\tnumber of worker threads sharing port, integer, 1-256, default(1)\n-d DIRECT_SIZE\t\twrite files of announced size of at least DIRECT_SIZE bytes with O_DIRECT, integer, >=0 (0 disables it), default(0)\n-i ENGINE\t\tI/O engine of workers and writer, epoll or uring (falls back to epoll if kernel does not support it), default(epoll)\n-L LOG_LEVEL\t\tevents written to stderr, debug (every chunk), info (starts and ends of transfers) or off, default(debug)\n-m METRICS_FILE\t\tfile rewritten every second by metrics in Prometheus text format (metrics are also dumped on stderr on SIGUSR1)\n-p PORT\t\t\tport of TCP and UDP sockets, integer, 1-65535, default(53)";
+        err_handle(msg, EXIT);
+    }
 }
 
-void create_dirs(char const *const path) {
-    char path_copy[strlen(path) + 1]; // not constant copy of path_const
-    char *cur = path_copy; // cursor
-
-    // Copy
-    strcpy(path_copy, path);
-
-    // Current dir notation './path'
-    if (*cur == '.' && *(cur + 1) == '/') {
-        cur++;
-    }
-
-    // Skip initial slash(es)
-    for (; *cur == '/'; cur++);
-
-    // Attempt to create directory(ies)
-    while (*cur != '\0') {
-        if (*(cur++) == '/') {
-            char tmp = *cur;
-            *cur = '\0';
-            if (mkdir(path_copy, 0777) == -1 && errno != EEXIST) {
-                char *msg2 = ": cannot create directory";
-                char msg1[strlen(path_copy) + strlen(msg2)];
-                strcpy(msg1, path_copy);
-                strcat(msg1, msg2);
-                err_handle(msg1, WARNING);
-                return;
-            }
-            if (errno == EEXIST) {
-                errno = 0;
-            }
-            *cur = tmp;
-        }
+void arg_check(char const *const BASE_HOST, char const *const BACKLOG, char const *const WORKERS, char const *const DIRECT, char const *const ENGINE, char const *const LOG_LEVEL, char const *const PORT_NUMBER) {
+    // Check backlog (optional)
+    check_number_lex(BACKLOG, "invalid backlog");
+    if (strtol(BACKLOG, NULL, 10) <= 0) {
+        err_handle("invalid backlog", EXIT);
+    }
+
+    // Check workers (optional)
+    check_number_lex(WORKERS, "invalid number of workers");
+    if (strlen(WORKERS) > 3 || strtol(WORKERS, NULL, 10) < 1 || strtol(WORKERS, NULL, 10) > MAX_WORKERS) {
+        err_handle("invalid number of workers", EXIT);
+    }
+
+    // Check direct size (optional)
+    check_number_lex(DIRECT, "invalid direct size");
+    if (strlen(DIRECT) > 19) {
+        err_handle("invalid direct size", EXIT);
     }
-}
\ No newline at end of file
+
+    // Check engine (optional)
+    if (strcmp(ENGINE, "epoll") && strcmp(ENGINE, "uring")) {
+        err_handle("invalid engine", EXIT);
+    }
+
+    // Check log level (optional)
+    if (log_parse(LOG_LEVEL) == -1) {
+        err_handle("invalid log level", EXIT);
+    }
+
+    // Check port (optional)
+    check_number_lex(PORT_NUMBER, "invalid port");
+    if (strlen(PORT_NUMBER) > 5 || strtol(PORT_NUMBER, NULL, 10) < 1 || strtol(PORT_NUMBER, NULL, 10) > 65535) {
+        err_handle("invalid port", EXIT);
+    }
+
+    // Check base host (positional)
+    check_host_lex(BASE_HOST);
+}
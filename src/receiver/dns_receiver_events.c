@@ -4,55 +4,38 @@
  * @Program Teacher's testing module intended for project evaluation purposes
  */
 
-#include <stdio.h>
+#include <stddef.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include "dns_receiver_events.h"
-
-#define NETADDR_STRLEN (INET6_ADDRSTRLEN > INET_ADDRSTRLEN ? INET6_ADDRSTRLEN : INET_ADDRSTRLEN)
-#define CREATE_IPV4STR(dst, src) char dst[NETADDR_STRLEN]; inet_ntop(AF_INET, src, dst, NETADDR_STRLEN)
-#define CREATE_IPV6STR(dst, src) char dst[NETADDR_STRLEN]; inet_ntop(AF_INET6, src, dst, NETADDR_STRLEN)
+#include "../common/log.h"
 
 void dns_receiver__on_query_parsed(char *filePath, char *encodedData)
 {
-	fprintf(stderr, "[PARS] %s '%s'\n", filePath, encodedData);
-}
-
-void on_chunk_received(char *source, char *filePath, int chunkId, int chunkSize)
-{
-	fprintf(stderr, "[RECV] %s %9d %dB from %s\n", filePath, chunkId, chunkSize, source);
+	log_event(LOG_PARSED, 0, NULL, filePath, 0, 0, encodedData);
 }
 
 void dns_receiver__on_chunk_received(struct in_addr *source, char *filePath, int chunkId, int chunkSize)
 {
-	CREATE_IPV4STR(address, source);
-	on_chunk_received(address, filePath, chunkId, chunkSize);
+	log_event(LOG_RECEIVED, AF_INET, source, filePath, chunkId, chunkSize, NULL);
 }
 
 void dns_receiver__on_chunk_received6(struct in6_addr *source, char *filePath, int chunkId, int chunkSize)
 {
-	CREATE_IPV6STR(address, source);
-	on_chunk_received(address, filePath, chunkId, chunkSize);
-}
-
-void on_transfer_init(char *source)
-{
-	fprintf(stderr, "[INIT] %s\n", source);
+	log_event(LOG_RECEIVED, AF_INET6, source, filePath, chunkId, chunkSize, NULL);
 }
 
 void dns_receiver__on_transfer_init(struct in_addr *source)
 {
-	CREATE_IPV4STR(address, source);
-	on_transfer_init(address);
+	log_event(LOG_INIT, AF_INET, source, NULL, 0, 0, NULL);
 }
 
 void dns_receiver__on_transfer_init6(struct in6_addr *source)
 {
-	CREATE_IPV6STR(address, source);
-	on_transfer_init(address);
+	log_event(LOG_INIT, AF_INET6, source, NULL, 0, 0, NULL);
 }
 
 void dns_receiver__on_transfer_completed(char *filePath, int fileSize)
 {
-	fprintf(stderr, "[CMPL] %s of %dB\n", filePath, fileSize);
+	log_event(LOG_COMPLETED, 0, NULL, filePath, 0, fileSize, NULL);
 }
@@ -0,0 +1,61 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's progress journals of resumable transfers (written prefix of output file and its checksum).
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <zlib.h>
+
+#include "journal.h"
+
+/**
+ * Makes path of journal of output file.
+ *
+ * @param buf Buffer of at least strlen('path') + sizeof(JOURNAL_SUFFIX) bytes.
+ * @param path Path of output file.
+ */
+static void journal_path(char *const buf, char const *const path);
+
+
+int journal_open(char const *const path, unsigned long long const size, unsigned long long const length, struct journal_record *const record) {
+    char journal[strlen(path) + sizeof(JOURNAL_SUFFIX)];
+    int fd;
+
+    journal_path(journal, path);
+    if ((fd = open(journal, O_RDWR | O_CREAT, 0666)) == -1) {
+        return -1;
+    }
+    if (pread(fd, record, sizeof(struct journal_record), 0) != sizeof(struct journal_record) ||
+        memcmp(record->magic, JOURNAL_MAGIC, sizeof(record->magic)) || record->size != size || record->committed > size || record->committed > length) {
+        memcpy(record->magic, JOURNAL_MAGIC, sizeof(record->magic));
+        record->crc = crc32(0, Z_NULL, 0);
+        record->size = size;
+        record->committed = 0;
+    }
+    errno = 0;
+
+    return fd;
+}
+
+int journal_write(int const fd, struct journal_record const *const record) {
+    return pwrite(fd, record, sizeof(struct journal_record), 0) != sizeof(struct journal_record);
+}
+
+void journal_remove(char const *const path) {
+    char journal[strlen(path) + sizeof(JOURNAL_SUFFIX)];
+
+    journal_path(journal, path);
+    if (unlink(journal)) { // usually there is none
+        errno = 0;
+    }
+}
+
+static void journal_path(char *const buf, char const *const path) {
+    strcpy(buf, path);
+    strcat(buf, JOURNAL_SUFFIX);
+}
@@ -0,0 +1,56 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's progress journals of resumable transfers (written prefix of output file and its checksum).
+ * @details header file
+ */
+
+// GUARD
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/// Suffix appended to path of output file to get path of its journal
+#define JOURNAL_SUFFIX ".journal"
+
+/// First bytes of journal
+#define JOURNAL_MAGIC "DNSJ"
+
+/// Only record of journal, rewritten in place (host byte order, journal is read only by receiver which wrote it)
+struct journal_record {
+    char magic[4]; // JOURNAL_MAGIC
+    unsigned crc; // CRC-32 of committed prefix
+    unsigned long long size; // announced size of file
+    unsigned long long committed; // length of prefix of file written by writer
+};
+
+/**
+ * Opens (creates) journal of output file and reads its record. Record of missing or damaged journal, of journal of
+ * file of other size, or of journal committing more than file contains, is reset to empty prefix.
+ *
+ * @param path Path of output file.
+ * @param size Announced size of file.
+ * @param length Current length of output file.
+ * @param record Record to be filled.
+ * @return Journal file descriptor, or -1 if it cannot be opened.
+ */
+int journal_open(char const *const path, unsigned long long const size, unsigned long long const length, struct journal_record *const record);
+
+/**
+ * Rewrites record of journal.
+ *
+ * @param fd Journal file descriptor.
+ * @param record Record.
+ * @return Zero on success, non-zero if write failed.
+ */
+int journal_write(int const fd, struct journal_record const *const record);
+
+/**
+ * Removes journal of output file (if there is any).
+ *
+ * @param path Path of output file.
+ */
+void journal_remove(char const *const path);
+
+// END GUARD
+#endif
@@ -0,0 +1,302 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's metrics (counters and latency histograms of every thread exported in Prometheus text format).
+ */
+
+#define _GNU_SOURCE // open_memstream()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "metrics.h"
+#include "../common/err.h"
+
+/// Number of sub-buckets of every power of two
+#define METRICS_SUB (1U << METRICS_SUB_BITS)
+
+/// Names and descriptions of counters (Prometheus counters labeled by thread)
+static char const *const metrics_counter_names[METRIC_COUNTERS][2] = {
+    {"dns_receiver_received_bytes_total", "Bytes of DNS messages received (TCP stream or datagrams)."},
+    {"dns_receiver_written_bytes_total", "Bytes of file data written into output files."},
+    {"dns_receiver_packets_total", "DNS messages processed."},
+    {"dns_receiver_responses_total", "Responses sent."},
+    {"dns_receiver_decode_errors_total", "Malformed DNS messages (or names, which cannot be decoded)."},
+    {"dns_receiver_syscalls_total", "System calls of receiving, sending, accepting, waiting and writing."},
+    {"dns_receiver_sessions_opened_total", "Sessions created."},
+    {"dns_receiver_sessions_closed_total", "Sessions destroyed."},
+    {"dns_receiver_transfers_total", "Completely received files."},
+};
+
+/// Names, descriptions and exported range (exponents of powers of two of nanoseconds) of histograms
+static struct {
+    char const *name;
+    char const *help;
+    unsigned min_exp; // the lowest exported bucket is 2^min_exp ns
+    unsigned max_exp; // the highest exported bucket is 2^max_exp ns
+} const metrics_histogram_names[METRIC_HISTOGRAMS] = {
+    {"dns_receiver_packet_processing_seconds", "Processing time of one DNS message.", 8, 30}, // 256 ns - 1 s
+    {"dns_receiver_transfer_duration_seconds", "Duration of transfer of file (from hello or legacy path packet to its end).", 20, 40}, // 1 ms - 18 min
+};
+
+/// Exported quantiles of histograms (computed from histograms of all threads)
+static double const metrics_quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+/// State of metrics shared by all threads
+static struct {
+    struct metrics *threads; // list of metrics of all registered threads (new ones are prepended atomically)
+    char const *path; // path of metrics file, NULL if there is none
+    int failed; // writing of metrics file failed already (warning is printed only once)
+} exporter;
+
+/// Metrics of calling thread, NULL if thread is not registered
+static __thread struct metrics *metrics_local;
+
+/**
+ * Body of metrics thread, waits for SIGUSR1 at most METRICS_INTERVAL seconds, then dumps and writes metrics.
+ *
+ * @param arg Unused.
+ * @return Never returns.
+ */
+static void *metrics_thread(void *const arg);
+
+/**
+ * Writes metrics of all threads in Prometheus text format into memory.
+ *
+ * @param len Pointer to which save length of text.
+ * @return Text (allocated), NULL if allocation failed.
+ */
+static char *metrics_text(size_t *const len);
+
+/**
+ * Writes one histogram of all threads and its quantiles.
+ *
+ * @param out Stream.
+ * @param histogram METRIC_*_TIME histogram.
+ */
+static void metrics_histogram(FILE *const out, int const histogram);
+
+/**
+ * Writes text into temporary file and renames it to metrics file, so reader never sees it incomplete.
+ *
+ * @param text Text.
+ * @param len Length of text.
+ */
+static void metrics_file(char const *const text, size_t const len);
+
+/**
+ * Finds bucket of value.
+ *
+ * @param value Value.
+ * @return Index of bucket.
+ */
+static unsigned metrics_index(unsigned long long const value);
+
+/**
+ * Computes the lowest value of bucket.
+ *
+ * @param index Index of bucket (METRICS_BUCKETS for upper bound of the last bucket).
+ * @return The lowest value.
+ */
+static unsigned long long metrics_lower(unsigned const index);
+
+
+void metrics_start(char const *const METRICS_FILE) {
+    sigset_t set;
+    pthread_t thread;
+
+    // Signal is accepted only by sigtimedwait() of metrics thread, all other threads inherit mask blocking it
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    if ((errno = pthread_sigmask(SIG_BLOCK, &set, NULL))) {
+        err_handle("blocking of SIGUSR1 failed", EXIT);
+    }
+    exporter.path = METRICS_FILE;
+    if ((errno = pthread_create(&thread, NULL, metrics_thread, NULL))) {
+        err_handle("metrics thread creation failed", EXIT);
+    }
+    pthread_detach(thread);
+}
+
+void metrics_register(char const *const name) {
+    if (!(metrics_local = calloc(1, sizeof(struct metrics)))) {
+        err_handle("failed to allocate metrics of thread", EXIT);
+    }
+    strncpy(metrics_local->name, name, sizeof(metrics_local->name) - 1);
+    metrics_local->next = __atomic_load_n(&exporter.threads, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&exporter.threads, &metrics_local->next, metrics_local, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+void metrics_count(int const counter, unsigned long long const value) {
+    // Only thread of metrics writes them, so plain addition is enough (stored atomically for metrics thread)
+    if (metrics_local) {
+        __atomic_store_n(metrics_local->counters + counter, metrics_local->counters[counter] + value, __ATOMIC_RELAXED);
+    }
+}
+
+void metrics_record(int const histogram, unsigned long long const value) {
+    if (metrics_local) {
+        unsigned long long *const bucket = metrics_local->buckets[histogram] + metrics_index(value);
+        __atomic_store_n(bucket, *bucket + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(metrics_local->sums + histogram, metrics_local->sums[histogram] + value, __ATOMIC_RELAXED);
+    }
+}
+
+unsigned long long metrics_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *metrics_thread(void *const arg) {
+    struct timespec const interval = {METRICS_INTERVAL, 0};
+    sigset_t set;
+    size_t len;
+    (void) arg;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    for (;;) {
+        int const sig = sigtimedwait(&set, NULL, &interval);
+        if (sig != SIGUSR1 && !exporter.path) {
+            continue;
+        }
+        char *const text = metrics_text(&len);
+        if (!text) {
+            err_handle("failed to allocate text of metrics", WARNING);
+            continue;
+        }
+        if (sig == SIGUSR1) {
+            fwrite(text, 1, len, stderr);
+        }
+        if (exporter.path) {
+            metrics_file(text, len);
+        }
+        free(text);
+        errno = 0;
+    }
+
+    return NULL;
+}
+
+static char *metrics_text(size_t *const len) {
+    char *text;
+    FILE *const out = open_memstream(&text, len);
+
+    if (!out) {
+        return NULL;
+    }
+    for (int i = 0; i < METRIC_COUNTERS; i++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s counter\n", metrics_counter_names[i][0], metrics_counter_names[i][1], metrics_counter_names[i][0]);
+        for (struct metrics *m = __atomic_load_n(&exporter.threads, __ATOMIC_ACQUIRE); m; m = m->next) {
+            fprintf(out, "%s{thread=\"%s\"} %llu\n", metrics_counter_names[i][0], m->name, __atomic_load_n(m->counters + i, __ATOMIC_RELAXED));
+        }
+    }
+    fprintf(out, "# HELP dns_receiver_sessions_active Sessions, which are open.\n# TYPE dns_receiver_sessions_active gauge\n");
+    for (struct metrics *m = __atomic_load_n(&exporter.threads, __ATOMIC_ACQUIRE); m; m = m->next) {
+        unsigned long long const opened = __atomic_load_n(m->counters + METRIC_OPENED, __ATOMIC_RELAXED);
+        unsigned long long const closed = __atomic_load_n(m->counters + METRIC_CLOSED, __ATOMIC_RELAXED);
+        fprintf(out, "dns_receiver_sessions_active{thread=\"%s\"} %llu\n", m->name, opened - closed);
+    }
+    for (int i = 0; i < METRIC_HISTOGRAMS; i++) {
+        metrics_histogram(out, i);
+    }
+    if (fclose(out)) {
+        free(text);
+        return NULL;
+    }
+
+    return text;
+}
+
+static void metrics_histogram(FILE *const out, int const histogram) {
+    static unsigned long long merged[METRICS_BUCKETS]; // buckets of all threads (only metrics thread uses it)
+    char const *const name = metrics_histogram_names[histogram].name;
+    unsigned long long total = 0;
+
+    // Exported buckets are powers of two, fine buckets are merged into them
+    fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, metrics_histogram_names[histogram].help, name);
+    memset(merged, 0, sizeof(merged));
+    for (struct metrics *m = __atomic_load_n(&exporter.threads, __ATOMIC_ACQUIRE); m; m = m->next) {
+        unsigned long long count = 0;
+        unsigned next = 0;
+        for (unsigned e = metrics_histogram_names[histogram].min_exp; e <= metrics_histogram_names[histogram].max_exp + 1; e++) {
+            unsigned const end = e <= metrics_histogram_names[histogram].max_exp ? metrics_index(1ULL << e) : METRICS_BUCKETS;
+            for (; next < end; next++) {
+                unsigned long long const bucket = __atomic_load_n(m->buckets[histogram] + next, __ATOMIC_RELAXED);
+                merged[next] += bucket;
+                count += bucket;
+            }
+            if (e <= metrics_histogram_names[histogram].max_exp) {
+                fprintf(out, "%s_bucket{thread=\"%s\",le=\"%.10g\"} %llu\n", name, m->name, (1ULL << e) / 1e9, count);
+            }
+        }
+        fprintf(out, "%s_bucket{thread=\"%s\",le=\"+Inf\"} %llu\n", name, m->name, count);
+        fprintf(out, "%s_sum{thread=\"%s\"} %.9f\n", name, m->name, __atomic_load_n(m->sums + histogram, __ATOMIC_RELAXED) / 1e9);
+        fprintf(out, "%s_count{thread=\"%s\"} %llu\n", name, m->name, count);
+        total += count;
+    }
+
+    // Quantile is reported as middle of its fine bucket
+    fprintf(out, "# HELP %s_quantile Quantiles of all threads.\n# TYPE %s_quantile gauge\n", name, name);
+    for (unsigned q = 0; q < sizeof(metrics_quantiles) / sizeof(*metrics_quantiles); q++) {
+        unsigned long long const rank = total * metrics_quantiles[q] + 0.5;
+        unsigned long long seen = 0;
+        unsigned i = 0;
+        while (i < METRICS_BUCKETS - 1 && (seen += merged[i]) < (rank ? rank : 1)) {
+            i++;
+        }
+        double const value = total ? (metrics_lower(i) / 2.0 + (metrics_lower(i + 1) - 1) / 2.0) / 1e9 : 0;
+        fprintf(out, "%s_quantile{quantile=\"%g\"} %.9f\n", name, metrics_quantiles[q], value);
+    }
+}
+
+static void metrics_file(char const *const text, size_t const len) {
+    char tmp[strlen(exporter.path) + sizeof(".tmp")];
+    FILE *file;
+
+    strcpy(tmp, exporter.path);
+    strcat(tmp, ".tmp");
+    int failed = !(file = fopen(tmp, "w"));
+    if (!failed) {
+        failed = fwrite(text, 1, len, file) != len;
+        failed = fclose(file) || failed || rename(tmp, exporter.path);
+    }
+    if (failed) {
+        if (!exporter.failed) {
+            err_handle("failed to write metrics file", WARNING);
+        }
+        exporter.failed = 1;
+        return;
+    }
+    exporter.failed = 0;
+}
+
+static unsigned metrics_index(unsigned long long const value) {
+    if (value < METRICS_SUB) {
+        return value;
+    }
+    unsigned const e = 63 - __builtin_clzll(value);
+
+    return ((e - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS) + (unsigned) (value >> (e - METRICS_SUB_BITS)) - METRICS_SUB;
+}
+
+static unsigned long long metrics_lower(unsigned const index) {
+    if (index < METRICS_SUB) {
+        return index;
+    }
+    if (index >= METRICS_BUCKETS) {
+        return ~0ULL;
+    }
+    unsigned const e = (index >> METRICS_SUB_BITS) + METRICS_SUB_BITS - 1;
+
+    return (unsigned long long) ((index & (METRICS_SUB - 1)) | METRICS_SUB) << (e - METRICS_SUB_BITS);
+}
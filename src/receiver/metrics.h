@@ -0,0 +1,89 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's metrics (counters and latency histograms of every thread exported in Prometheus text format).
+ * @details header file
+ */
+
+// GUARD
+#ifndef METRICS_H
+#define METRICS_H
+
+/// Counters of thread
+#define METRIC_RECEIVED 0 // bytes of DNS messages received (TCP stream or datagrams)
+#define METRIC_WRITTEN 1 // bytes of file data written into output files
+#define METRIC_PACKETS 2 // DNS messages processed
+#define METRIC_RESPONSES 3 // responses sent
+#define METRIC_DECODE_ERRORS 4 // malformed DNS messages (or names, which cannot be decoded)
+#define METRIC_SYSCALLS 5 // system calls of receiving, sending, accepting, waiting and writing
+#define METRIC_OPENED 6 // sessions created
+#define METRIC_CLOSED 7 // sessions destroyed (active sessions are created ones, which are not destroyed yet)
+#define METRIC_TRANSFERS 8 // completely received files
+#define METRIC_COUNTERS 9
+
+/// Histograms of thread (values are in nanoseconds)
+#define METRIC_PACKET_TIME 0 // processing of one DNS message
+#define METRIC_TRANSFER_TIME 1 // transfer of file (from hello or legacy path packet to its end)
+#define METRIC_HISTOGRAMS 2
+
+/**
+ * Histograms are logarithmic with linear sub-buckets (like HDR histogram), every power of two is split into
+ * 2^METRICS_SUB_BITS buckets, so recorded value is known with relative error below 2^-METRICS_SUB_BITS.
+ */
+#define METRICS_SUB_BITS 4
+#define METRICS_BUCKETS ((64 - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS)
+
+/// Interval in seconds of rewriting metrics file
+#define METRICS_INTERVAL 1
+
+/// Metrics of one thread, written only by its thread and read by metrics thread
+struct metrics {
+    char name[16]; // value of label 'thread'
+    unsigned long long counters[METRIC_COUNTERS]; // METRIC_* counters
+    unsigned long long sums[METRIC_HISTOGRAMS]; // sums of recorded values
+    unsigned long long buckets[METRIC_HISTOGRAMS][METRICS_BUCKETS]; // numbers of recorded values
+    struct metrics *next; // metrics of next thread
+};
+
+/**
+ * Starts metrics thread, which rewrites metrics file every METRICS_INTERVAL seconds and dumps metrics to standard error
+ * output on SIGUSR1. Has to be called before any other thread is created (SIGUSR1 is blocked in all threads, it is
+ * accepted only by metrics thread).
+ *
+ * @param METRICS_FILE Path of metrics file (written into temporary file, which is renamed), NULL if there is none.
+ */
+void metrics_start(char const *const METRICS_FILE);
+
+/**
+ * Allocates metrics of calling thread, only metrics of registered threads are counted.
+ *
+ * @param name Value of label 'thread' of metrics.
+ */
+void metrics_register(char const *const name);
+
+/**
+ * Adds value to counter of calling thread.
+ *
+ * @param counter METRIC_* counter.
+ * @param value Value.
+ */
+void metrics_count(int const counter, unsigned long long const value);
+
+/**
+ * Records value into histogram of calling thread.
+ *
+ * @param histogram METRIC_*_TIME histogram.
+ * @param value Value in nanoseconds.
+ */
+void metrics_record(int const histogram, unsigned long long const value);
+
+/**
+ * Reads monotonic clock.
+ *
+ * @return Time in nanoseconds.
+ */
+unsigned long long metrics_now(void);
+
+// END GUARD
+#endif
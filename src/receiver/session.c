@@ -0,0 +1,851 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's per-client session handling.
+ */
+
+#define _GNU_SOURCE // fallocate()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "session.h"
+#include "../common/err.h"
+#include "dns_receiver_events.h"
+
+/**
+ * Opens output file of session with path carried by first packet (legacy path or hello).
+ *
+ * @param session Session waiting for path.
+ * @param hello Parsed first packet.
+ * @param DST_DIRPATH Destination directory path program argument.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_open(struct session *const session, struct proto_hello const *const hello, char const *const DST_DIRPATH);
+
+/**
+ * Continues resumed session from offset carried by resume packet (committed prefix of file, or its beginning), progress
+ * of file is journaled since then.
+ *
+ * @param session Session waiting for resume packet.
+ * @param chunk Payload of resume packet.
+ * @param chunk_len Length of payload.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_resume(struct session *const session, char const *const chunk, short const chunk_len);
+
+/**
+ * Answers query of TCP session by response carrying progress of file (hello of resumed session), or acknowledgement
+ * of whole file (end of file mark).
+ *
+ * @param session TCP session, which was just opened with PROTO_FLAG_RESUME flag, or which has just received file.
+ * @param dns DNS packet with hello (without prefixed length).
+ * @param dns_len Length of DNS packet.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_answer(struct session *const session, char const *const dns, unsigned short const dns_len);
+
+/**
+ * Writes data chunk into output file of session. Chunks of session with PROTO_FLAG_SEQ flag are written at offset
+ * given by their sequence number, chunks of session with PROTO_FLAG_OFFSET flag are written at offset they carry, others
+ * are appended. Duplicates of positioned chunks are dropped (by window, or by bitmap of received chunks, if size of file
+ * is known).
+ *
+ * @param session Session receiving file.
+ * @param chunk Payload of packet.
+ * @param chunk_len Length of payload.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_write(struct session *const session, char const *const chunk, short const chunk_len);
+
+/**
+ * Moves cumulative acknowledgement of session by one sequence number, bitmap of sequence numbers received ahead of it
+ * is shifted (bit of sequence number following old cumulative acknowledgement is dropped).
+ *
+ * @param session Datagram session.
+ */
+static void session_slide(struct session *const session);
+
+/**
+ * Stores chunk into write buffer of session. Buffer is submitted to writer first, if chunk does not continue its data,
+ * and whenever it is full. Buffer is full at aligned offset of output file (chunk is split there), so following buffers
+ * start aligned.
+ *
+ * @param session Session with open output file.
+ * @param offset Offset of chunk in output file.
+ * @param chunk Data of chunk.
+ * @param chunk_len Length of data.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_store(struct session *const session, long offset, char const *chunk, unsigned short chunk_len);
+
+/**
+ * Passes data chunk of compressed session to decompressor. Chunk of datagram session is stored into its slot first and
+ * all chunks below cumulative acknowledgement are decompressed.
+ *
+ * @param session Session with PROTO_FLAG_DEFLATE flag.
+ * @param seq Sequence number of chunk (datagram session only, cumulative acknowledgement is already moved over it).
+ * @param chunk Data of chunk.
+ * @param chunk_len Length of data (zero for end of file mark).
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_decompress(struct session *const session, unsigned const seq, char const *const chunk, unsigned short const chunk_len);
+
+/**
+ * Decompresses data straight into write buffer of session, which is submitted to writer whenever it is full.
+ * Decompressed data are appended to output file.
+ *
+ * @param session Session with PROTO_FLAG_DEFLATE flag.
+ * @param data Compressed data.
+ * @param len Length of compressed data.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_inflate(struct session *const session, char const *const data, unsigned short const len);
+
+/**
+ * Submits write buffer of session (if it has any data) to writer, which writes it into output file at its offset.
+ *
+ * @param session Session with open output file.
+ * @return Zero on success, non-zero if some write of output file failed.
+ */
+static int session_flush(struct session *const session);
+
+/**
+ * Processes chunk carried by one question of DNS packet (see 'session_process()').
+ *
+ * @param session Session to which packet belongs.
+ * @param chunk Payload of question.
+ * @param chunk_len Length of payload.
+ * @param datagram_hello Non-zero if payload is hello of datagram session.
+ * @param DST_DIRPATH Destination directory path program argument.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_chunk(struct session *const session, char const *const chunk, short const chunk_len, int const datagram_hello, char const *const DST_DIRPATH);
+
+/**
+ * Closes output file of session and invokes transfer completed event, records metrics of completed transfer.
+ *
+ * @param session Session with open output file.
+ * @param completed Non-zero if whole file was received.
+ */
+static void session_close_file(struct session *const session, int const completed);
+
+/**
+ * Processes all complete frames (prefixed length and DNS packet) of receive buffer of session and moves incomplete
+ * rest to beginning of buffer.
+ *
+ * @param session TCP session.
+ * @param base Base host.
+ * @param DST_DIRPATH Destination directory path program argument.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+static int session_frames(struct session *const session, struct base_host const *const base, char const *const DST_DIRPATH);
+
+
+struct session *session_create(int const connfd, struct sockaddr_in const *const cliaddr, struct writer *const writer) {
+    struct session *session;
+
+    if (!(session = calloc(1, sizeof(struct session)))) {
+        return NULL;
+    }
+    if (connfd != -1 && !(session->recv_buf = malloc(SESSION_RECV_BUF))) {
+        free(session);
+        return NULL;
+    }
+    session->connfd = connfd;
+    session->cliaddr = *cliaddr;
+    session->writer = writer;
+    session->state = SESSION_PATH;
+    session->last_active = time(NULL);
+    session->reply = -1;
+    metrics_count(METRIC_OPENED, 1);
+    session->journal_fd = -1;
+
+    // Initialize event
+    event_init(&session->event);
+    session->event.addr = &session->cliaddr.sin_addr;
+
+    return session;
+}
+
+int session_receive(struct session *const session, struct base_host const *const base, char const *const DST_DIRPATH) {
+    for (;;) {
+        // Read as much as fits behind already received data
+        unsigned const space = SESSION_RECV_BUF - session->recv_end;
+        ssize_t const bytes_read = read(session->connfd, session->recv_buf + session->recv_end, space);
+        metrics_count(METRIC_SYSCALLS, 1);
+
+        if (bytes_read == 0) { // connection closed with FIN flag
+            session->eof = 1;
+            return SESSION_CLOSED;
+        } else if (bytes_read == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) { // no more data available for now
+                errno = 0;
+                return SESSION_OPEN;
+            } else if (errno == EINTR) {
+                errno = 0;
+                continue;
+            }
+            err_handle("cannot read from client socket", WARNING);
+            return SESSION_CLOSED;
+        }
+        session->last_active = time(NULL);
+        session->recv_end += bytes_read;
+        metrics_count(METRIC_RECEIVED, bytes_read);
+
+        if (session_frames(session, base, DST_DIRPATH)) {
+            return SESSION_CLOSED;
+        }
+        if (bytes_read < space) { // socket is drained
+            return SESSION_OPEN;
+        }
+    }
+}
+
+int session_feed(struct session *const session, char const *data, unsigned len, struct base_host const *const base, char const *const DST_DIRPATH) {
+    session->last_active = time(NULL);
+
+    // Processed frames free the buffer, only incomplete frame shorter than DNS_MAX_MESSAGE stays in it
+    while (len) {
+        unsigned const space = SESSION_RECV_BUF - session->recv_end;
+        unsigned const part = len < space ? len : space;
+        memcpy(session->recv_buf + session->recv_end, data, part);
+        session->recv_end += part;
+        data += part;
+        len -= part;
+        if (session_frames(session, base, DST_DIRPATH)) {
+            return SESSION_CLOSED;
+        }
+    }
+
+    return SESSION_OPEN;
+}
+
+static int session_frames(struct session *const session, struct base_host const *const base, char const *const DST_DIRPATH) {
+    while (session->recv_end - session->recv_start >= DNS_TCP) {
+        char const *const frame = session->recv_buf + session->recv_start;
+        unsigned short const dns_len = ntohs(*((unsigned short *) frame));
+
+        if (!dns_len || dns_len > DNS_MAX_MESSAGE - DNS_TCP) {
+            err_handle("invalid length of received DNS packet", WARNING);
+            metrics_count(METRIC_DECODE_ERRORS, 1);
+            return 1;
+        }
+        if (session->recv_end - session->recv_start < DNS_TCP + dns_len) { // frame is still incomplete
+            break;
+        }
+
+        // Whole DNS packet is received, it is processed directly in buffer
+        unsigned long long const start = metrics_now();
+        int const ret = session_process(session, frame + DNS_TCP, dns_len, base, DST_DIRPATH);
+        metrics_record(METRIC_PACKET_TIME, metrics_now() - start);
+        metrics_count(METRIC_PACKETS, 1);
+        if (ret) {
+            return 1;
+        }
+        session->recv_start += DNS_TCP + dns_len;
+    }
+
+    // Move incomplete frame (shorter than DNS_MAX_MESSAGE) to beginning of buffer
+    session->recv_end -= session->recv_start;
+    memmove(session->recv_buf, session->recv_buf + session->recv_start, session->recv_end);
+    session->recv_start = 0;
+
+    return 0;
+}
+
+int session_process(struct session *const session, char const *const dns, unsigned short const dns_len, struct base_host const *const base, char const *const DST_DIRPATH) {
+    char chunk[DNS_MAX_NAME - base->text_len]; // every codec encodes byte into at least one character
+    unsigned short offset = DNS_HEADER, questions = 0;
+    int const state = session->state;
+    int ret;
+
+    // Every question carries one chunk
+    if (dns_len >= DNS_HEADER) {
+        questions = ntohs(((struct dns_header const *) dns)->q_count);
+    }
+    if (!questions || questions > DNS_MAX_QUESTIONS) {
+        metrics_count(METRIC_DECODE_ERRORS, 1);
+        if (session->connfd != -1) {
+            err_handle("invalid number of questions of received DNS packet", WARNING);
+        }
+        return session->connfd != -1;
+    }
+
+    // Only the first question of datagram may be hello
+    int const datagram_hello = session->connfd == -1 && proto_query_type(dns, dns_len) == PROTO_TYPE_HELLO;
+    for (unsigned short i = 0; i < questions; i++) {
+        /* First packet of session (and every hello, also the one following finished file of TCP session) is encoded with
+         * base16, the rest with codec announced by hello */
+        int const hello = datagram_hello && !i;
+        int const path = session->state == SESSION_PATH || (session->state == SESSION_DONE && session->connfd != -1);
+        struct codec const *const codec = hello || path ? codec_by_id(CODEC_BASE16) : session->codec;
+        short const chunk_len = disassemble_dns_packet(dns, dns_len, &offset, base, codec, chunk, &session->event);
+        if (chunk_len < 0) { // not sent by sender (malformed, other base host or invalid encoding)
+            metrics_count(METRIC_DECODE_ERRORS, 1);
+            if (session->connfd != -1) {
+                err_handle("invalid name of question of received DNS packet", WARNING);
+            }
+            return session->connfd != -1;
+        }
+        if ((ret = session_chunk(session, chunk, chunk_len, hello, DST_DIRPATH))) {
+            return ret;
+        }
+    }
+
+    // Sender of resumed session waits for progress of file before continuing, sender of whole file for acknowledgement
+    if (session->connfd != -1 && session->state != state && (session->state == SESSION_RESUME || session->state == SESSION_DONE)) {
+        return session_answer(session, dns, dns_len);
+    }
+
+    return 0;
+}
+
+static int session_chunk(struct session *const session, char const *const chunk, short const chunk_len, int const datagram_hello, char const *const DST_DIRPATH) {
+    struct proto_hello hello;
+
+    // Datagram session is (re)started only by hello, retransmitted hello of current session is ignored
+    if (datagram_hello) {
+        if (proto_hello_decode(chunk, chunk_len, &hello) || !(hello.flags & PROTO_FLAG_SEQ)) {
+            return 0;
+        }
+        if (session->state != SESSION_PATH && hello.id == session->id) {
+            return 0;
+        }
+        if (session->state == SESSION_DATA) { // previous transfer was not finished
+            session_close_file(session, 0);
+        }
+        session->state = SESSION_PATH;
+        return session_open(session, &hello, DST_DIRPATH);
+    }
+
+    switch (session->state) {
+        case SESSION_DONE:
+            if (session->connfd == -1) { // retransmitted chunk of already received file
+                return 0;
+            }
+            // TCP session carrying batch of files continues by hello of next file
+            // fall through
+        case SESSION_PATH:
+            if (session->connfd == -1) { // datagram session has not received hello yet
+                return 0;
+            }
+            if (proto_hello_decode(chunk, chunk_len, &hello)) {
+                err_handle("invalid path packet", WARNING);
+                return 1;
+            }
+            return session_open(session, &hello, DST_DIRPATH);
+        case SESSION_DATA:
+            return session_write(session, chunk, chunk_len);
+        case SESSION_RESUME:
+            return session_resume(session, chunk, chunk_len);
+        default:
+            return 0;
+    }
+}
+
+static int session_open(struct session *const session, struct proto_hello const *const hello, char const *const DST_DIRPATH) {
+    // Reset state of previous transfer of datagram session
+    free(session->path);
+    session->path = NULL;
+    free(session->received);
+    session->received = NULL;
+    session->write_len = 0;
+    event_init(&session->event);
+    session->event.addr = &session->cliaddr.sin_addr;
+    session->flags = hello->flags;
+    session->id = hello->id;
+    session->chunk_size = hello->chunk_size;
+    session->size = hello->size;
+    if ((hello->flags & PROTO_FLAG_OFFSET) && !(hello->flags & PROTO_FLAG_SIZE)) {
+        err_handle("file offsets of session require size of file", WARNING);
+        return 1;
+    }
+    if ((hello->flags & PROTO_FLAG_OFFSET) && (hello->flags & PROTO_FLAG_DEFLATE)) {
+        err_handle("compressed session cannot carry file offsets", WARNING);
+        return 1;
+    }
+    int const resume = hello->flags & PROTO_FLAG_RESUME;
+    if (resume && (session->connfd == -1 || !(hello->flags & PROTO_FLAG_SIZE) || (hello->flags & (PROTO_FLAG_SEQ | PROTO_FLAG_OFFSET)))) {
+        err_handle("resumed session has to be single TCP session with size of file", WARNING);
+        return 1;
+    }
+    if (!(session->codec = codec_by_id(hello->codec))) {
+        err_handle("codec of session is not supported", WARNING);
+        return 1;
+    }
+    session->cum = session->end_known = session->end_seq = 0;
+    memset(session->sack, 0, sizeof(session->sack));
+    session->file_pos = 0;
+
+    // Process path, concatenate it with destination directory path
+    short DST_DIRPATH_len = strlen(DST_DIRPATH);
+    if (!(session->path = malloc(DST_DIRPATH_len + hello->path_len + 2))) {
+        err_handle("failed to allocate path of session", WARNING);
+        return 1;
+    }
+    memcpy(session->path, DST_DIRPATH, DST_DIRPATH_len + 1);
+    if (session->path[DST_DIRPATH_len - 1] != '/' && *hello->path != '/')
+        strcat(session->path, "/");
+    strncat(session->path, hello->path, hello->path_len);
+    session->event.filePath = session->path;
+
+    /* Open (create) file (and possibly directories) for write, file received by more connections in parallel is not
+     * truncated (other sessions might have written their ranges already), it is only resized to announced size, neither
+     * is file of resumed session (its prefix might be kept), journal of file received otherwise is stale */
+    create_dirs(session->path);
+    int const parallel = hello->flags & PROTO_FLAG_OFFSET;
+    int fd;
+    if (!resume) {
+        journal_remove(session->path);
+    }
+    if ((fd = open(session->path, O_WRONLY | O_CREAT | (parallel || resume ? 0 : O_TRUNC), 0666)) != -1 && parallel && ftruncate(fd, hello->size)) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd == -1) {
+        char *msg2 = ": failed to open file for write";
+        char msg1[strlen(session->path) + strlen(msg2) + 1];
+        strcpy(msg1, session->path);
+        strcat(msg1, msg2);
+        err_handle(msg1, WARNING);
+        return 1;
+    }
+    if (!(session->file = writer_open(session->writer, fd, session->path, hello->flags & PROTO_FLAG_SIZE ? hello->size : 0))) {
+        close(fd);
+        err_handle("failed to allocate output file of session", WARNING);
+        return 1;
+    }
+
+    // Progress of previous transfer of file is read before file is resized to announced size
+    struct stat st;
+    if (resume && (fstat(fd, &st) || (session->journal_fd = journal_open(session->path, hello->size, st.st_size, &session->journal)) == -1 ||
+                   ftruncate(fd, hello->size))) {
+        err_handle("failed to open progress journal of file", WARNING);
+        return 1;
+    }
+
+    // Space of file of announced size is allocated at once (file system might not support it, then file grows by writes)
+    if ((hello->flags & PROTO_FLAG_SIZE) && hello->size && fallocate(fd, 0, 0, hello->size)) {
+        if (errno == ENOSPC) {
+            err_handle("not enough space for received file", WARNING);
+            return 1;
+        }
+        errno = 0;
+    }
+
+    // Chunks of file of known size, which carry their position, are tracked by bitmap (positions of compressed chunks
+    // are not bounded by size of file)
+    if ((hello->flags & PROTO_FLAG_SIZE) && (hello->flags & (PROTO_FLAG_SEQ | PROTO_FLAG_OFFSET)) && !(hello->flags & PROTO_FLAG_DEFLATE)) {
+        unsigned long long const chunks = (hello->size + hello->chunk_size - 1) / hello->chunk_size;
+        if (!(session->received = calloc(chunks / 8 + 1, 1))) {
+            err_handle("failed to allocate bitmap of received chunks", WARNING);
+            return 1;
+        }
+    }
+
+    // Compressed chunks of datagram session are reordered in slots before decompression
+    if (hello->flags & PROTO_FLAG_DEFLATE) {
+        size_t const slots = hello->flags & PROTO_FLAG_SEQ ? (size_t) (PROTO_WINDOW + 1) * hello->chunk_size : 0;
+        if (!(session->inflate = calloc(1, sizeof(struct session_inflate) + slots))) {
+            err_handle("failed to allocate decompressor of session", WARNING);
+            return 1;
+        }
+        if (inflateInit(&session->inflate->strm) != Z_OK) {
+            free(session->inflate);
+            session->inflate = NULL;
+            err_handle("failed to initialize decompressor of session", WARNING);
+            return 1;
+        }
+    }
+
+    // Start receiving of file (resumed session waits for resume packet first)
+    session->state = resume ? SESSION_RESUME : SESSION_DATA;
+    session->event.active = ACTIVE;
+    session->started = metrics_now();
+    EVENT(dns_receiver__on_transfer_init(session->event.addr));
+
+    return 0;
+}
+
+static int session_answer(struct session *const session, char const *const dns, unsigned short const dns_len) {
+    char frame[DNS_TCP + PROTO_MAX_RESPONSE];
+    struct proto_progress const progress = {session->journal.committed, session->journal.crc};
+    struct proto_ack ack;
+    unsigned short len;
+
+    // Response is short, so it fits into send buffer of socket
+    if (session->state == SESSION_RESUME) {
+        len = proto_build_progress(frame + DNS_TCP, dns, dns_len, &progress);
+    } else {
+        session_ack(session, &ack);
+        len = proto_build_response(frame + DNS_TCP, dns, dns_len, &ack);
+    }
+    *((unsigned short *) frame) = htons(len);
+    metrics_count(METRIC_SYSCALLS, len != 0);
+    if (!len || write(session->connfd, frame, DNS_TCP + len) != DNS_TCP + len) {
+        err_handle("cannot answer query of session", WARNING);
+        return 1;
+    }
+    metrics_count(METRIC_RESPONSES, 1);
+
+    return 0;
+}
+
+static int session_resume(struct session *const session, char const *const chunk, short const chunk_len) {
+    if (chunk_len != PROTO_OFFSET) {
+        err_handle("invalid resume packet", WARNING);
+        return 1;
+    }
+
+    // Sender either skips committed prefix, or sends file whole (its prefix differs)
+    unsigned long long const offset = proto_get_offset(chunk);
+    if (offset && offset != session->journal.committed) {
+        err_handle("resume offset does not match progress of file", WARNING);
+        return 1;
+    }
+    if (!offset) {
+        session->journal.crc = crc32(0, Z_NULL, 0);
+        session->journal.committed = 0;
+    }
+    if (journal_write(session->journal_fd, &session->journal)) { // rewritten before prefix is overwritten
+        err_handle("failed to write progress journal of file", WARNING);
+        return 1;
+    }
+    writer_journal(session->file, session->journal_fd, &session->journal);
+    session->journal_fd = -1;
+    session->file_pos = offset;
+    session->state = SESSION_DATA;
+
+    return 0;
+}
+
+static int session_write(struct session *const session, char const *chunk, short chunk_len) {
+    unsigned seq = session->event.chunkId;
+    long offset = session->file_pos; // chunks of legacy session are appended
+
+    if (session->flags & PROTO_FLAG_SEQ) {
+        if (chunk_len < PROTO_SEQ) { // malformed chunk
+            return 0;
+        }
+        seq = proto_get_seq(chunk);
+        chunk += PROTO_SEQ;
+        chunk_len -= PROTO_SEQ;
+
+        // Drop duplicates and chunks outside of window
+        unsigned const distance = seq - session->cum;
+        unsigned const bit = distance - 1;
+        if ((int) distance < 0 || distance > PROTO_WINDOW || (distance && session->sack[bit / PROTO_SACK] >> bit % PROTO_SACK & 1) || chunk_len > session->chunk_size) {
+            return 0;
+        }
+
+        // Mark chunk received and move cumulative acknowledgement over received sequence numbers
+        if (distance) {
+            session->sack[bit / PROTO_SACK] |= 1ULL << bit % PROTO_SACK;
+        } else {
+            int received; // sequence number following 'cum' was received ahead
+            do {
+                received = session->sack[0] & 1;
+                session_slide(session);
+            } while (received);
+        }
+
+        // End of file mark
+        if (!chunk_len) {
+            session->end_seq = seq;
+            session->end_known = 1;
+        }
+
+        offset = (long) seq * session->chunk_size;
+    } else if (session->flags & PROTO_FLAG_OFFSET) {
+        if (chunk_len < PROTO_OFFSET) { // malformed chunk
+            return 0;
+        }
+        unsigned long long const position = proto_get_offset(chunk);
+        chunk += PROTO_OFFSET;
+        chunk_len -= PROTO_OFFSET;
+
+        // Drop chunks outside of announced file and chunks not starting at chunk boundary (end of file mark has no data)
+        if (chunk_len && (chunk_len > session->chunk_size || position + chunk_len > session->size || position % session->chunk_size)) {
+            return 0;
+        }
+        offset = (long) position;
+        seq = position / session->chunk_size;
+    }
+
+    // Drop chunks outside of announced file and duplicates (checked by one bit of chunk)
+    if (session->received && chunk_len) {
+        if ((unsigned long long) offset + chunk_len > session->size || session->received[seq / 8] >> seq % 8 & 1) {
+            return 0;
+        }
+        session->received[seq / 8] |= 1 << seq % 8;
+    }
+
+    // Compressed data are decompressed in order and appended to file
+    if (session->inflate && session_decompress(session, seq, chunk, chunk_len)) {
+        return 1;
+    }
+
+    if (chunk_len) {
+        if (!session->inflate) {
+            if (session_store(session, offset, chunk, chunk_len)) {
+                return 1;
+            }
+            session->file_pos = offset + chunk_len;
+        }
+        EVENT(dns_receiver__on_chunk_received(session->event.addr, session->event.filePath, seq, chunk_len));
+        session->event.fileSize += chunk_len;
+        session->event.chunkId++;
+    }
+
+    // Whole file was received (end of file mark of TCP session follows all chunks, they are delivered in order)
+    if (session->flags & PROTO_FLAG_SEQ ? session->end_known && session->cum > session->end_seq : !chunk_len && (session->flags & PROTO_FLAG_FIN)) {
+        session_close_file(session, 1);
+        session->state = SESSION_DONE;
+    }
+
+    return 0;
+}
+
+static void session_slide(struct session *const session) {
+    // The lowest bit (sequence number following old 'cum') is shifted out
+    for (unsigned i = 0; i < SESSION_SACK_WORDS - 1; i++) {
+        session->sack[i] = session->sack[i] >> 1 | session->sack[i + 1] << (PROTO_SACK - 1);
+    }
+    session->sack[SESSION_SACK_WORDS - 1] >>= 1;
+    session->cum++;
+}
+
+static int session_store(struct session *const session, long offset, char const *chunk, unsigned short chunk_len) {
+    if (session->write_len && offset != session->write_pos + session->write_len && session_flush(session)) {
+        return 1;
+    }
+
+    while (chunk_len) {
+        if (!session->write_buf && !(session->write_buf = writer_buffer(session->writer))) {
+            err_handle("failed to allocate write buffer of session", WARNING);
+            return 1;
+        }
+        if (!session->write_len) {
+            session->write_pos = offset;
+        }
+
+        // Copy as much as fits before aligned end of buffer
+        unsigned const space = WRITER_BUF - session->write_pos % WRITER_ALIGN - session->write_len;
+        unsigned short const len = chunk_len < space ? chunk_len : space;
+        memcpy(session->write_buf + session->write_len, chunk, len);
+        session->write_len += len;
+        offset += len;
+        chunk += len;
+        chunk_len -= len;
+        if (len == space && session_flush(session)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int session_decompress(struct session *const session, unsigned const seq, char const *const chunk, unsigned short const chunk_len) {
+    struct session_inflate *const z = session->inflate;
+
+    if (!(session->flags & PROTO_FLAG_SEQ)) {
+        return session_inflate(session, chunk, chunk_len);
+    }
+
+    // All chunks below cumulative acknowledgement are received, so they are decompressed in order
+    unsigned const slot = seq % (PROTO_WINDOW + 1);
+    memcpy(z->chunks + slot * session->chunk_size, chunk, chunk_len);
+    z->lens[slot] = chunk_len;
+    for (; z->next != session->cum; z->next++) {
+        unsigned const next = z->next % (PROTO_WINDOW + 1);
+        if (session_inflate(session, z->chunks + next * session->chunk_size, z->lens[next])) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int session_inflate(struct session *const session, char const *const data, unsigned short const len) {
+    z_stream *const strm = &session->inflate->strm;
+
+    strm->next_in = (Bytef *) data;
+    strm->avail_in = len;
+    while (!session->inflate->end && (strm->avail_in || !strm->avail_out)) {
+        if (!session->write_buf && !(session->write_buf = writer_buffer(session->writer))) {
+            err_handle("failed to allocate write buffer of session", WARNING);
+            return 1;
+        }
+        if (!session->write_len) {
+            session->write_pos = session->file_pos;
+        }
+
+        // Decompress as much as fits before aligned end of buffer (see 'session_store()')
+        unsigned const space = WRITER_BUF - session->write_pos % WRITER_ALIGN - session->write_len;
+        strm->next_out = (Bytef *) session->write_buf + session->write_len;
+        strm->avail_out = space;
+        int const ret = inflate(strm, Z_NO_FLUSH);
+        session->write_len += space - strm->avail_out;
+        session->file_pos += space - strm->avail_out;
+        if (ret == Z_STREAM_END) {
+            session->inflate->end = 1;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            err_handle("invalid compressed data of session", WARNING);
+            return 1;
+        }
+        if (!strm->avail_out && session_flush(session)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int session_flush(struct session *const session) {
+    if (session->write_len) {
+        writer_submit(session->file, session->write_buf, session->write_len, session->write_pos);
+        session->write_buf = NULL;
+        session->write_len = 0;
+    }
+
+    return writer_failed(session->file);
+}
+
+static void session_close_file(struct session *const session, int const completed) {
+    if (session->journal_fd != -1) { // session was not resumed
+        close(session->journal_fd);
+        session->journal_fd = -1;
+    }
+    if (session->inflate) {
+        if (!session->inflate->end) {
+            err_handle("compressed data of session are incomplete", WARNING);
+        }
+        inflateEnd(&session->inflate->strm);
+        free(session->inflate);
+        session->inflate = NULL;
+    }
+    session_flush(session);
+    writer_close(session->file);
+    session->file = NULL;
+    free(session->received);
+    session->received = NULL;
+    if (completed) {
+        metrics_record(METRIC_TRANSFER_TIME, metrics_now() - session->started);
+        metrics_count(METRIC_TRANSFERS, 1);
+    }
+    EVENT(dns_receiver__on_transfer_completed(session->event.filePath, session->event.fileSize));
+}
+
+void session_ack(struct session const *const session, struct proto_ack *const ack) {
+    ack->flags = session->state == SESSION_DONE ? PROTO_ACK_DONE : 0;
+    ack->cum = session->cum;
+    ack->sack = session->sack[0];
+}
+
+void session_destroy(struct session *const session) {
+    metrics_count(METRIC_CLOSED, 1);
+    if (session->connfd != -1) {
+        close(session->connfd);
+    }
+    // Legacy session ends by orderly close of connection after its last complete packet
+    if (session->file) {
+        session_close_file(session, !session->flags && session->eof && session->recv_start == session->recv_end);
+    }
+    free(session->path);
+    free(session->write_buf);
+    free(session->recv_buf);
+    free(session);
+}
+
+void session_list_append(struct session_list *const list, struct session *const session) {
+    session->prev = list->tail;
+    session->next = NULL;
+    if (list->tail) {
+        list->tail->next = session;
+    } else {
+        list->head = session;
+    }
+    list->tail = session;
+    list->count++;
+}
+
+void session_list_remove(struct session_list *const list, struct session *const session) {
+    if (session->prev) {
+        session->prev->next = session->next;
+    } else {
+        list->head = session->next;
+    }
+    if (session->next) {
+        session->next->prev = session->prev;
+    } else {
+        list->tail = session->prev;
+    }
+    session->prev = session->next = NULL;
+    list->count--;
+}
+
+short disassemble_dns_packet(char const *const dns, short const dns_len, unsigned short *const offset, struct base_host const *const base, struct codec const *const codec, char *const buf, struct event *const event) {
+    char text[DNS_MAX_NAME + 1]; // textual name for event
+    int const chunks = EVENT_CHUNKS(event);
+
+    if (dns_len < DNS_HEADER) {
+        return -1;
+    }
+
+    // Decode data straight from packet, textual name is produced only if chunk events are consumed
+    short const data_len = name_decode(dns, dns_len, offset, base, codec, buf, chunks ? text : NULL);
+    if (data_len < 0 || *offset + DNS_TAIL > dns_len) {
+        return -1;
+    }
+    *offset += DNS_TAIL;
+
+    // Handle event
+    if (chunks) {
+        EVENT(dns_receiver__on_query_parsed(event->filePath, text));
+    }
+
+    return data_len;
+}
+
+void create_dirs(char const *const path) {
+    char path_copy[strlen(path) + 1]; // not constant copy of path_const
+    char *cur = path_copy; // cursor
+
+    // Copy
+    strcpy(path_copy, path);
+
+    // Current dir notation './path'
+    if (*cur == '.' && *(cur + 1) == '/') {
+        cur++;
+    }
+
+    // Skip initial slash(es)
+    for (; *cur == '/'; cur++);
+
+    // Attempt to create directory(ies)
+    while (*cur != '\0') {
+        if (*(cur++) == '/') {
+            char tmp = *cur;
+            *cur = '\0';
+            if (mkdir(path_copy, 0777) == -1 && errno != EEXIST) {
+                char *msg2 = ": cannot create directory";
+                char msg1[strlen(path_copy) + strlen(msg2) + 1];
+                strcpy(msg1, path_copy);
+                strcat(msg1, msg2);
+                err_handle(msg1, WARNING);
+                return;
+            }
+            if (errno == EEXIST) {
+                errno = 0;
+            }
+            *cur = tmp;
+        }
+    }
+}
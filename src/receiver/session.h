@@ -0,0 +1,221 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's per-client session handling.
+ * @details header file
+ */
+
+// GUARD
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdio.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <zlib.h>
+
+#include "../common/definitions.h"
+#include "../common/events.h"
+#include "../common/protocol.h"
+#include "../common/codec.h"
+#include "../common/name.h"
+#include "writer.h"
+#include "metrics.h"
+
+/// Session status returned by 'session_receive()'
+#define SESSION_OPEN 0
+#define SESSION_CLOSED 1
+
+/// Size of receive buffer of TCP session
+#define SESSION_RECV_BUF 65536
+
+/// Number of words of bitmap of sequence numbers received ahead of cumulative acknowledgement
+#define SESSION_SACK_WORDS (PROTO_WINDOW / PROTO_SACK)
+
+/// Session states
+#define SESSION_PATH 0 // waiting for path (hello) packet
+#define SESSION_DATA 1 // receiving file
+#define SESSION_DONE 2 // whole file received (datagram session waits for retransmissions to be acknowledged, TCP
+                        // session for hello of next file of batch)
+#define SESSION_RESUME 3 // hello of resumed session was answered by progress, waiting for resume packet
+
+/**
+ * Decompression of session with PROTO_FLAG_DEFLATE flag. Compressed stream is decompressed in order, so chunks of
+ * datagram session received ahead of cumulative acknowledgement wait in slots (indexed by sequence number).
+ */
+struct session_inflate {
+    z_stream strm; // zlib stream
+    int end; // end of compressed stream was reached
+    unsigned next; // sequence number of next chunk to be decompressed (datagram session)
+    unsigned short lens[PROTO_WINDOW + 1]; // lengths of chunks waiting in slots
+    char chunks[]; // PROTO_WINDOW + 1 slots of 'chunk_size' bytes (datagram session only)
+};
+
+/**
+ * State of one client connection or datagram peer (one transferred file).
+ *
+ * Every session owns its output file (written behind by writer thread of its worker) and event data (and socket, if it is TCP session), so any number of sessions can
+ * be processed concurrently by one event loop. Sessions are linked into list ordered by time of last activity (oldest
+ * first), which is used to close idle sessions.
+ */
+struct session {
+    int connfd; // client's socket file descriptor, -1 for datagram session (server's socket is shared)
+    struct sockaddr_in cliaddr; // client's address
+    struct event event; // event data of this session
+    int state; // SESSION_PATH, SESSION_DATA, SESSION_DONE or SESSION_RESUME
+    struct writer *writer; // writer of worker serving session
+    struct writer_file *file; // output file, NULL until path packet is received
+    char *path; // full path of output file (allocated), NULL until path packet is received
+    long file_pos; // offset following the last written chunk (chunks of legacy session are appended there)
+    char *write_buf; // contiguous chunks not written into output file yet (taken from writer only while it has data)
+    unsigned write_len; // length of data in write buffer
+    long write_pos; // offset of data of write buffer in output file
+    time_t last_active; // time of last received data
+    unsigned long long started; // time of hello of transfer (by 'metrics_now()')
+
+    unsigned char flags; // PROTO_FLAG_* flags of session (zero for legacy session)
+    unsigned id; // session identifier from hello
+    unsigned short chunk_size; // maximum length of chunk data from hello
+    struct codec const *codec; // codec of packets following path packet (hello)
+    unsigned long long size; // total size of file from hello, valid with PROTO_FLAG_SIZE flag
+    unsigned char *received; // bitmap of received chunks (bit 'i' for chunk at offset 'i' * 'chunk_size'), allocated
+                             // only if size of file is known and chunks carry their position, NULL otherwise
+    unsigned cum; // lowest sequence number not received yet
+    unsigned long long sack[SESSION_SACK_WORDS]; // received sequence numbers following 'cum' (bit 'i' of word 'w' for
+                                                 // 'cum' + 1 + 'w' * PROTO_SACK + 'i')
+    unsigned end_seq; // sequence number of end of file mark, valid if 'end_known' is set
+    int end_known; // non-zero if end of file mark was received
+    struct session_inflate *inflate; // decompression of session with PROTO_FLAG_DEFLATE flag (allocated), NULL otherwise
+    int journal_fd; // progress journal of resumed session until resume packet (then owned by output file), -1 otherwise
+    struct journal_record journal; // record of progress journal read when session was opened
+
+    struct session *hnext; // next session in the same bucket of datagram sessions table
+    int reply; // index of pending response of datagram session in current batch, -1 if there is none
+
+    char *recv_buf; // receive buffer of TCP session (allocated, SESSION_RECV_BUF bytes), NULL for datagram session
+    unsigned recv_start; // offset of first unprocessed byte in receive buffer
+    unsigned recv_end; // offset of end of received data in receive buffer
+    int closing; // socket was shut down, session is destroyed when its receive request ends (io_uring engine only)
+    int eof; // client closed connection with FIN flag (orderly end of legacy session)
+
+    struct session *prev; // previous (less recently active) session
+    struct session *next; // next (more recently active) session
+};
+
+/// List of sessions ordered by time of last activity
+struct session_list {
+    struct session *head; // least recently active session
+    struct session *tail; // most recently active session
+    unsigned count; // number of sessions in list
+};
+
+/**
+ * Allocates and initializes session of accepted client connection.
+ *
+ * @param connfd Client's socket file descriptor (non-blocking), -1 for datagram session.
+ * @param cliaddr Client's address.
+ * @param writer Writer of worker serving session.
+ * @return Pointer to new session, or NULL if allocation failed.
+ */
+struct session *session_create(int const connfd, struct sockaddr_in const *const cliaddr, struct writer *const writer);
+
+/**
+ * Reads data available on session's socket into receive buffer by large blocks and processes every complete DNS
+ * packet in place. First packet of session is destination file path, which is opened, every other packet is data
+ * chunk, which is written into it.
+ *
+ * Never blocks. Reading stops when socket did not fill the whole free space of buffer (socket is level-triggered, so
+ * rest is read by later calls). Partially received packet is kept at beginning of buffer and completed by later calls.
+ *
+ * @param session Session to be served.
+ * @param base Base host.
+ * @param DST_DIRPATH Destination directory path program argument.
+ * @return SESSION_CLOSED if transfer has ended (client closed connection, or error occurred) and session has to be
+ * destroyed, SESSION_OPEN otherwise.
+ */
+int session_receive(struct session *const session, struct base_host const *const base, char const *const DST_DIRPATH);
+
+/**
+ * Processes data received on session's socket by caller (io_uring engine receives them into provided buffers). Data
+ * are appended to receive buffer and processed like by 'session_receive()'.
+ *
+ * @param session TCP session.
+ * @param data Received data.
+ * @param len Length of received data.
+ * @param base Base host.
+ * @param DST_DIRPATH Destination directory path program argument.
+ * @return SESSION_CLOSED if error occurred and session has to be closed, SESSION_OPEN otherwise.
+ */
+int session_feed(struct session *const session, char const *data, unsigned len, struct base_host const *const base, char const *const DST_DIRPATH);
+
+/**
+ * Processes one complete DNS packet of session, every its question carries one chunk. If session waits for path, opens
+ * output file with path carried by question (legacy path, or hello), otherwise writes carried data chunk into output
+ * file. Datagram session restarts with new hello (TXT query) carrying different session identifier.
+ *
+ * @param session Session to which packet belongs.
+ * @param dns DNS packet (without prefixed length).
+ * @param dns_len Length of DNS packet.
+ * @param base Base host.
+ * @param DST_DIRPATH Destination directory path program argument.
+ * @return Zero on success, non-zero if session has to be closed.
+ */
+int session_process(struct session *const session, char const *const dns, unsigned short const dns_len, struct base_host const *const base, char const *const DST_DIRPATH);
+
+/**
+ * Fills acknowledgement of chunks received by session.
+ *
+ * @param session Session.
+ * @param ack Acknowledgement to be filled.
+ */
+void session_ack(struct session const *const session, struct proto_ack *const ack);
+
+/**
+ * Closes session's socket and output file, invokes transfer completed event (if transfer was initiated) and frees
+ * session.
+ *
+ * @param session Session to be destroyed.
+ */
+void session_destroy(struct session *const session);
+
+/**
+ * Appends session to the end (most recently active position) of list.
+ *
+ * @param list List of sessions.
+ * @param session Session not contained in any list.
+ */
+void session_list_append(struct session_list *const list, struct session *const session);
+
+/**
+ * Removes session from list.
+ *
+ * @param list List of sessions.
+ * @param session Session contained in 'list'.
+ */
+void session_list_remove(struct session_list *const list, struct session *const session);
+
+/**
+ * Extract data from one question of DNS packet (decoded directly from its name, see 'name_decode()'). Packet carrying
+ * more questions is walked by calling it repeatedly with the same 'offset'.
+ *
+ * @param dns DNS packet.
+ * @param dns_len Length of DNS packet passed in 'dns' parameter.
+ * @param offset Offset of question (DNS_HEADER for the first one), moved behind question (to the next one) on success.
+ * @param base Base host, which has to end name of question.
+ * @param codec Codec with which data are encoded.
+ * @param buf Buffer to which save extracted data from DNS packet.
+ * @param event Event data of session to which packet belongs.
+ * @return Number of bytes extracted from DNS packet, -1 if packet is malformed.
+ */
+short disassemble_dns_packet(char const *const dns, short const dns_len, unsigned short *const offset, struct base_host const *const base, struct codec const *const codec, char *const buf, struct event *const event);
+
+/**
+ * Attempts to create all directories contained in path.
+ *
+ * @param path_const Path.
+ */
+void create_dirs(char const *const path);
+
+// END GUARD
+#endif
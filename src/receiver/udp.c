@@ -0,0 +1,194 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's datagram (UDP) transport.
+ */
+
+#define _GNU_SOURCE // recvmmsg(), sendmmsg()
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "udp.h"
+#include "metrics.h"
+#include "../common/err.h"
+
+/**
+ * Finds datagram session of client.
+ *
+ * @param udp Datagram server.
+ * @param cliaddr Client's address.
+ * @return Pointer to bucket (pointer to session, or NULL if there is no session of client).
+ */
+static struct session **udp_lookup(struct udp_server *const udp, struct sockaddr_in const *const cliaddr);
+
+/**
+ * Sends pending responses of batch.
+ *
+ * @param udp Datagram server.
+ * @param responses Responses.
+ * @param responses_len Lengths of responses.
+ * @param repliers Sessions to which responses belong (NULL if session was destroyed in meantime).
+ * @param count Number of responses.
+ */
+static void udp_send_responses(struct udp_server *const udp, char responses[][PROTO_MAX_RESPONSE], unsigned short const *const responses_len, struct session *const *const repliers, int const count);
+
+
+void udp_init(struct udp_server *const udp, int const sockfd, struct writer *const writer) {
+    udp->sockfd = sockfd;
+    udp->writer = writer;
+    memset(udp->table, 0, sizeof(udp->table));
+}
+
+static struct session **udp_lookup(struct udp_server *const udp, struct sockaddr_in const *const cliaddr) {
+    unsigned const hash = (ntohl(cliaddr->sin_addr.s_addr) * 31 + ntohs(cliaddr->sin_port)) % UDP_TABLE;
+    struct session **bucket = udp->table + hash;
+
+    while (*bucket && ((*bucket)->cliaddr.sin_addr.s_addr != cliaddr->sin_addr.s_addr || (*bucket)->cliaddr.sin_port != cliaddr->sin_port)) {
+        bucket = &(*bucket)->hnext;
+    }
+
+    return bucket;
+}
+
+void udp_forget(struct udp_server *const udp, struct session *const session) {
+    struct session **const bucket = udp_lookup(udp, &session->cliaddr);
+
+    if (*bucket == session) {
+        *bucket = session->hnext;
+        session->hnext = NULL;
+    }
+}
+
+void udp_receive(struct udp_server *const udp, struct session_list *const sessions, struct base_host const *const base, char const *const DST_DIRPATH) {
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iovecs[UDP_BATCH];
+    struct sockaddr_in addrs[UDP_BATCH];
+    char datagrams[UDP_BATCH][DNS_MAX_PACKET];
+    char responses[UDP_BATCH][PROTO_MAX_RESPONSE];
+    unsigned short responses_len[UDP_BATCH];
+    struct session *repliers[UDP_BATCH];
+    struct proto_ack ack;
+    int count;
+
+    do {
+        // Receive batch of datagrams
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < UDP_BATCH; i++) {
+            iovecs[i].iov_base = datagrams[i];
+            iovecs[i].iov_len = DNS_MAX_PACKET;
+            msgs[i].msg_hdr.msg_iov = iovecs + i;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = addrs + i;
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        }
+        count = recvmmsg(udp->sockfd, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+        metrics_count(METRIC_SYSCALLS, 1);
+        if (count < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                err_handle("cannot receive datagrams", WARNING);
+            }
+            errno = 0;
+            return;
+        }
+
+        // Process datagrams, every session gets only one (the latest) acknowledgement per batch
+        int replies = 0;
+        for (int i = 0; i < count; i++) {
+            char const *const dns = datagrams[i];
+            unsigned short const dns_len = msgs[i].msg_len;
+            struct session **const bucket = udp_lookup(udp, addrs + i);
+            struct session *session = *bucket;
+
+            metrics_count(METRIC_RECEIVED, dns_len);
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) { // too long to be query of this application
+                metrics_count(METRIC_DECODE_ERRORS, 1);
+                continue;
+            }
+
+            // Create session for new client (only hello can start it)
+            if (!session) {
+                if (proto_query_type(dns, dns_len) != PROTO_TYPE_HELLO) {
+                    continue;
+                }
+                if (!(session = session_create(-1, addrs + i, udp->writer))) {
+                    err_handle("failed to allocate session", WARNING);
+                    continue;
+                }
+                *bucket = session;
+            } else {
+                session_list_remove(sessions, session);
+            }
+            session_list_append(sessions, session); // move to most recently active position
+            session->last_active = time(NULL);
+
+            unsigned long long const start = metrics_now();
+            int const ret = session_process(session, dns, dns_len, base, DST_DIRPATH);
+            metrics_record(METRIC_PACKET_TIME, metrics_now() - start);
+            metrics_count(METRIC_PACKETS, 1);
+            if (ret) {
+                if (session->reply != -1) {
+                    repliers[session->reply] = NULL;
+                }
+                udp_forget(udp, session);
+                session_list_remove(sessions, session);
+                session_destroy(session);
+                continue;
+            }
+
+            // Prepare acknowledgement
+            if (!(session->flags & PROTO_FLAG_ACK) || session->state == SESSION_PATH) {
+                continue;
+            }
+            int const slot = session->reply != -1 ? session->reply : replies;
+            session_ack(session, &ack);
+            unsigned short const response_len = proto_build_response(responses[slot], dns, dns_len, &ack);
+            if (!response_len) {
+                continue;
+            }
+            responses_len[slot] = response_len;
+            if (session->reply == -1) {
+                session->reply = replies++;
+                repliers[slot] = session;
+            }
+        }
+
+        udp_send_responses(udp, responses, responses_len, repliers, replies);
+    } while (count == UDP_BATCH); // full batch, more datagrams might be waiting
+}
+
+static void udp_send_responses(struct udp_server *const udp, char responses[][PROTO_MAX_RESPONSE], unsigned short const *const responses_len, struct session *const *const repliers, int const count) {
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iovecs[UDP_BATCH];
+    int msgs_count = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < count; i++) {
+        if (!repliers[i]) { // session was destroyed
+            continue;
+        }
+        iovecs[msgs_count].iov_base = responses[i];
+        iovecs[msgs_count].iov_len = responses_len[i];
+        msgs[msgs_count].msg_hdr.msg_iov = iovecs + msgs_count;
+        msgs[msgs_count].msg_hdr.msg_iovlen = 1;
+        msgs[msgs_count].msg_hdr.msg_name = (void *) &repliers[i]->cliaddr;
+        msgs[msgs_count].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs_count++;
+        repliers[i]->reply = -1;
+    }
+
+    // Lost responses are recovered by retransmissions of client, so sending is not repeated
+    if (!msgs_count) {
+        return;
+    }
+    int const sent = sendmmsg(udp->sockfd, msgs, msgs_count, MSG_DONTWAIT);
+    metrics_count(METRIC_SYSCALLS, 1);
+    if (sent < 0) {
+        err_handle("cannot send responses", WARNING);
+        return;
+    }
+    metrics_count(METRIC_RESPONSES, sent);
+}
@@ -0,0 +1,59 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's datagram (UDP) transport.
+ * @details header file
+ */
+
+// GUARD
+#ifndef UDP_H
+#define UDP_H
+
+#include "session.h"
+
+/// Number of buckets of datagram sessions table
+#define UDP_TABLE 1024
+
+/// Maximum number of datagrams received (and responses sent) by one system call
+#define UDP_BATCH 64
+
+/**
+ * Datagram server of one worker. Sessions are identified by address and port of client.
+ */
+struct udp_server {
+    int sockfd; // server's UDP socket file descriptor (non-blocking)
+    struct writer *writer; // writer of worker (of files of its sessions)
+    struct session *table[UDP_TABLE]; // datagram sessions table
+};
+
+/**
+ * Initializes datagram server with empty sessions table.
+ *
+ * @param udp Datagram server.
+ * @param sockfd Bound non-blocking UDP socket file descriptor.
+ * @param writer Writer of worker.
+ */
+void udp_init(struct udp_server *const udp, int const sockfd, struct writer *const writer);
+
+/**
+ * Receives all datagrams currently available on server's socket in batches, processes them by their sessions (creating
+ * session for every new hello) and answers every session of batch by one acknowledgement.
+ *
+ * @param udp Datagram server.
+ * @param sessions List of open sessions (new sessions are appended, active ones are moved to its end).
+ * @param base Base host.
+ * @param DST_DIRPATH Destination directory path program argument.
+ */
+void udp_receive(struct udp_server *const udp, struct session_list *const sessions, struct base_host const *const base, char const *const DST_DIRPATH);
+
+/**
+ * Removes datagram session from sessions table (session is not destroyed).
+ *
+ * @param udp Datagram server.
+ * @param session Datagram session contained in table.
+ */
+void udp_forget(struct udp_server *const udp, struct session *const session);
+
+// END GUARD
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's minimal io_uring interface (raw system calls, no library is required).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+#include "metrics.h"
+
+/**
+ * Creates io_uring instance with flags, if kernel supports them.
+ *
+ * @param entries Number of entries of submission queue.
+ * @param flags IORING_SETUP_* flags.
+ * @param params Parameters filled by kernel.
+ * @return io_uring file descriptor, or -1 (errno is set).
+ */
+static int uring_setup(unsigned const entries, unsigned const flags, struct io_uring_params *const params);
+
+
+int uring_init(struct uring *const uring, unsigned const entries) {
+    struct io_uring_params params;
+
+    // Completions are processed only by thread waiting for them (less interrupts), older kernels process them anytime
+    memset(uring, 0, sizeof(struct uring));
+    if ((uring->fd = uring_setup(entries, IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN, &params)) == -1 &&
+        (errno != EINVAL || (uring->fd = uring_setup(entries, IORING_SETUP_CQSIZE, &params)) == -1)) {
+        return 1;
+    }
+
+    // Map rings (single mapping is shared by both rings on newer kernels)
+    uring->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    uring->cq_ring_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP && uring->cq_ring_len > uring->sq_ring_len) {
+        uring->sq_ring_len = uring->cq_ring_len;
+    }
+    uring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring->sq_ring = mmap(NULL, uring->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+    uring->cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? uring->sq_ring :
+                     mmap(NULL, uring->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING);
+    uring->sqes = mmap(NULL, uring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+    if (uring->sq_ring == MAP_FAILED || uring->cq_ring == MAP_FAILED || uring->sqes == MAP_FAILED) {
+        int const err = errno;
+        uring_exit(uring);
+        errno = err;
+        return 1;
+    }
+
+    char *const sq = uring->sq_ring, *const cq = uring->cq_ring;
+    uring->sq_head = (unsigned *) (sq + params.sq_off.head);
+    uring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    uring->sq_mask = *(unsigned *) (sq + params.sq_off.ring_mask);
+    uring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    uring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    uring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    uring->cq_mask = *(unsigned *) (cq + params.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    // Entries are used in order, so array maps every index to itself
+    for (unsigned i = 0; i <= uring->sq_mask; i++) {
+        uring->sq_array[i] = i;
+    }
+
+    return 0;
+}
+
+struct io_uring_sqe *uring_sqe(struct uring *const uring) {
+    unsigned const tail = *uring->sq_tail;
+
+    if (tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) > uring->sq_mask) { // queue is full
+        uring_submit(uring, 0, -1);
+    }
+    struct io_uring_sqe *const sqe = uring->sqes + (tail & uring->sq_mask);
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    __atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    uring->sq_pending++;
+
+    return sqe;
+}
+
+int uring_submit(struct uring *const uring, unsigned const wait, int const timeout) {
+    struct __kernel_timespec ts = {timeout / 1000, timeout % 1000 * 1000000L};
+    struct io_uring_getevents_arg arg = {0, _NSIG / 8, 0, (unsigned long) &ts};
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+
+    if (wait && timeout >= 0) {
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    for (;;) {
+        int const ret = syscall(__NR_io_uring_enter, uring->fd, uring->sq_pending, wait, flags, flags & IORING_ENTER_EXT_ARG ? (void *) &arg : NULL, sizeof(arg));
+        metrics_count(METRIC_SYSCALLS, 1);
+        if (ret >= 0) {
+            uring->sq_pending -= ret < (int) uring->sq_pending ? ret : uring->sq_pending;
+            return 0;
+        }
+        if (errno == ETIME) { // nothing completed in time
+            errno = 0;
+            uring->sq_pending = 0; // entries are consumed before waiting
+            return 0;
+        }
+        if (errno != EINTR) {
+            return 1;
+        }
+        errno = 0;
+    }
+}
+
+struct io_uring_cqe *uring_cqe(struct uring *const uring) {
+    unsigned const head = *uring->cq_head;
+
+    if (head == __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    return uring->cqes + (head & uring->cq_mask);
+}
+
+void uring_seen(struct uring *const uring) {
+    __atomic_store_n(uring->cq_head, *uring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+void uring_prep_accept(struct uring *const uring, int const sockfd, unsigned long long const user_data) {
+    struct io_uring_sqe *const sqe = uring_sqe(uring);
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = sockfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK;
+    sqe->user_data = user_data;
+}
+
+void uring_prep_recv(struct uring *const uring, int const sockfd, unsigned short const group, unsigned long long const user_data) {
+    struct io_uring_sqe *const sqe = uring_sqe(uring);
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sockfd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = group;
+    sqe->user_data = user_data;
+}
+
+void uring_prep_poll(struct uring *const uring, int const fd, unsigned long long const user_data) {
+    struct io_uring_sqe *const sqe = uring_sqe(uring);
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = user_data;
+}
+
+void uring_prep_write(struct uring *const uring, int const fd, char const *const buf, unsigned const len, long const pos, unsigned long long const user_data) {
+    struct io_uring_sqe *const sqe = uring_sqe(uring);
+
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long) buf;
+    sqe->len = len;
+    sqe->off = pos;
+    sqe->user_data = user_data;
+}
+
+int uring_buffers_init(struct uring *const uring, struct uring_buffers *const buffers, unsigned short const group, unsigned const count, unsigned const size) {
+    struct io_uring_buf_reg reg;
+
+    // Ring has to be page aligned
+    buffers->ring = mmap(NULL, count * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers->ring == MAP_FAILED) {
+        return 1;
+    }
+    if (!(buffers->data = malloc((size_t) count * size))) {
+        munmap(buffers->ring, count * sizeof(struct io_uring_buf));
+        return 1;
+    }
+    buffers->count = count;
+    buffers->size = size;
+    buffers->group = group;
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long) buffers->ring;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (syscall(__NR_io_uring_register, uring->fd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+        int const err = errno;
+        free(buffers->data);
+        munmap(buffers->ring, count * sizeof(struct io_uring_buf));
+        errno = err;
+        return 1;
+    }
+
+    // Provide all buffers
+    buffers->ring->tail = 0;
+    for (unsigned i = 0; i < count; i++) {
+        uring_buffer_recycle(buffers, i);
+    }
+
+    return 0;
+}
+
+char *uring_buffer(struct uring_buffers const *const buffers, unsigned short const id) {
+    return buffers->data + (size_t) id * buffers->size;
+}
+
+void uring_buffer_recycle(struct uring_buffers *const buffers, unsigned short const id) {
+    unsigned short const tail = buffers->ring->tail;
+    struct io_uring_buf *const buf = buffers->ring->bufs + (tail & (buffers->count - 1));
+
+    buf->addr = (unsigned long) uring_buffer(buffers, id);
+    buf->len = buffers->size;
+    buf->bid = id;
+    __atomic_store_n(&buffers->ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+void uring_exit(struct uring *const uring) {
+    if (uring->sqes && uring->sqes != MAP_FAILED) {
+        munmap(uring->sqes, uring->sqes_len);
+    }
+    if (uring->cq_ring && uring->cq_ring != MAP_FAILED && uring->cq_ring != uring->sq_ring) {
+        munmap(uring->cq_ring, uring->cq_ring_len);
+    }
+    if (uring->sq_ring && uring->sq_ring != MAP_FAILED) {
+        munmap(uring->sq_ring, uring->sq_ring_len);
+    }
+    close(uring->fd);
+}
+
+static int uring_setup(unsigned const entries, unsigned const flags, struct io_uring_params *const params) {
+    memset(params, 0, sizeof(struct io_uring_params));
+    params->flags = flags;
+    params->cq_entries = URING_CQ_ENTRIES;
+
+    return syscall(__NR_io_uring_setup, entries, params);
+}
@@ -0,0 +1,167 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's minimal io_uring interface (raw system calls, no library is required).
+ * @details header file
+ */
+
+// GUARD
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+/// Number of entries of completion queue (completions of multishot requests are not limited by submission queue)
+#define URING_CQ_ENTRIES 4096
+
+/// io_uring instance with mapped submission and completion queues, used only by thread which created it
+struct uring {
+    int fd; // io_uring file descriptor
+    unsigned *sq_head; // head of submission queue (moved by kernel)
+    unsigned *sq_tail; // tail of submission queue
+    unsigned sq_mask; // mask of indexes of submission queue
+    unsigned *sq_array; // indexes of entries of submission queue
+    struct io_uring_sqe *sqes; // entries of submission queue
+    unsigned sq_pending; // number of entries prepared since last submission
+    unsigned *cq_head; // head of completion queue
+    unsigned *cq_tail; // tail of completion queue (moved by kernel)
+    unsigned cq_mask; // mask of indexes of completion queue
+    struct io_uring_cqe *cqes; // entries of completion queue
+    void *sq_ring; // mapping of submission queue ring
+    size_t sq_ring_len; // length of mapping of submission queue ring
+    void *cq_ring; // mapping of completion queue ring (the same as 'sq_ring' with single mapping)
+    size_t cq_ring_len; // length of mapping of completion queue ring
+    size_t sqes_len; // length of mapping of submission queue entries
+};
+
+/// Ring of buffers provided to kernel, which selects one for every completed receive
+struct uring_buffers {
+    struct io_uring_buf_ring *ring; // ring shared with kernel
+    char *data; // memory of all buffers
+    unsigned count; // number of buffers (power of two)
+    unsigned size; // size of one buffer
+    unsigned short group; // buffer group identifier
+};
+
+/**
+ * Creates io_uring instance.
+ *
+ * @param uring Instance to be initialized.
+ * @param entries Number of entries of submission queue (power of two).
+ * @return Zero on success, non-zero if io_uring is not supported (errno is set).
+ */
+int uring_init(struct uring *const uring, unsigned const entries);
+
+/**
+ * Takes free submission queue entry (zeroed), submits prepared entries first if queue is full.
+ *
+ * @param uring Instance.
+ * @return Entry to be prepared.
+ */
+struct io_uring_sqe *uring_sqe(struct uring *const uring);
+
+/**
+ * Submits prepared entries and waits for completions.
+ *
+ * @param uring Instance.
+ * @param wait Minimum number of completions to wait for (zero only submits).
+ * @param timeout Maximum time of waiting in milliseconds, negative waits without limit.
+ * @return Zero on success (or timeout), non-zero on error (errno is set).
+ */
+int uring_submit(struct uring *const uring, unsigned const wait, int const timeout);
+
+/**
+ * Peeks at the oldest completion, which has to be released by 'uring_seen()'.
+ *
+ * @param uring Instance.
+ * @return Completion, or NULL if there is none.
+ */
+struct io_uring_cqe *uring_cqe(struct uring *const uring);
+
+/**
+ * Releases the oldest completion.
+ *
+ * @param uring Instance.
+ */
+void uring_seen(struct uring *const uring);
+
+/**
+ * Prepares multishot accept of connections on listening socket (one completion per accepted connection).
+ *
+ * @param uring Instance.
+ * @param sockfd Listening socket file descriptor.
+ * @param user_data Identifier of request passed to its completions.
+ */
+void uring_prep_accept(struct uring *const uring, int const sockfd, unsigned long long const user_data);
+
+/**
+ * Prepares multishot receive from socket into provided buffers (one completion per received block).
+ *
+ * @param uring Instance.
+ * @param sockfd Socket file descriptor.
+ * @param group Group of provided buffers.
+ * @param user_data Identifier of request passed to its completions.
+ */
+void uring_prep_recv(struct uring *const uring, int const sockfd, unsigned short const group, unsigned long long const user_data);
+
+/**
+ * Prepares multishot poll for readability of file descriptor.
+ *
+ * @param uring Instance.
+ * @param fd File descriptor.
+ * @param user_data Identifier of request passed to its completions.
+ */
+void uring_prep_poll(struct uring *const uring, int const fd, unsigned long long const user_data);
+
+/**
+ * Prepares write of buffer into file at offset.
+ *
+ * @param uring Instance.
+ * @param fd File descriptor.
+ * @param buf Data.
+ * @param len Length of data.
+ * @param pos Offset in file.
+ * @param user_data Identifier of request passed to its completion.
+ */
+void uring_prep_write(struct uring *const uring, int const fd, char const *const buf, unsigned const len, long const pos, unsigned long long const user_data);
+
+/**
+ * Allocates buffers and registers them as provided buffer ring.
+ *
+ * @param uring Instance.
+ * @param buffers Buffers to be initialized.
+ * @param group Buffer group identifier.
+ * @param count Number of buffers (power of two, at most 32768).
+ * @param size Size of one buffer.
+ * @return Zero on success, non-zero if buffers cannot be provided (errno is set).
+ */
+int uring_buffers_init(struct uring *const uring, struct uring_buffers *const buffers, unsigned short const group, unsigned const count, unsigned const size);
+
+/**
+ * Finds data of buffer selected by completion.
+ *
+ * @param buffers Buffers.
+ * @param id Buffer identifier (from flags of completion).
+ * @return Data of buffer.
+ */
+char *uring_buffer(struct uring_buffers const *const buffers, unsigned short const id);
+
+/**
+ * Returns buffer selected by completion back to kernel.
+ *
+ * @param buffers Buffers.
+ * @param id Buffer identifier (from flags of completion).
+ */
+void uring_buffer_recycle(struct uring_buffers *const buffers, unsigned short const id);
+
+/**
+ * Destroys io_uring instance (pending requests are canceled).
+ *
+ * @param uring Instance.
+ */
+void uring_exit(struct uring *const uring);
+
+// END GUARD
+#endif
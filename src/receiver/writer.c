@@ -0,0 +1,354 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's write-behind of output files (buffers are written by background thread of every worker).
+ */
+
+#define _GNU_SOURCE // O_DIRECT
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "writer.h"
+#include "uring.h"
+#include "metrics.h"
+#include "../common/err.h"
+
+/**
+ * Body of writer thread, performs queued jobs in order forever.
+ *
+ * @param arg Pointer to 'struct writer'.
+ * @return Never returns.
+ */
+static void *writer_thread(void *const arg);
+
+/**
+ * Takes all queued jobs, waits until there is at least one.
+ *
+ * @param writer Writer.
+ * @param jobs Array of WRITER_QUEUE jobs to which save taken jobs.
+ * @return Number of taken jobs.
+ */
+static unsigned writer_take(struct writer *const writer, struct writer_job *const jobs);
+
+/**
+ * Queues job to writer of its file, waits while queue is full.
+ *
+ * @param job Job.
+ */
+static void writer_push(struct writer_job const *const job);
+
+/**
+ * Chooses file descriptor for write, aligned block is written directly (around page cache), if file is open so.
+ *
+ * @param file Output file.
+ * @param pos Offset of block.
+ * @param len Length of block.
+ * @return File descriptor.
+ */
+static int writer_fd(struct writer_file const *const file, long const pos, unsigned const len);
+
+/**
+ * Writes buffer of job into its file by 'pwrite()'.
+ *
+ * @param job Job with buffer.
+ */
+static void writer_write(struct writer_job const *const job);
+
+/**
+ * Writes buffers of all jobs by one io_uring submission, writes which failed or were short are repeated by
+ * 'writer_write()' (which reports errors).
+ *
+ * @param uring io_uring instance of writer thread.
+ * @param jobs Jobs.
+ * @param count Number of jobs.
+ */
+static void writer_write_uring(struct uring *const uring, struct writer_job const *const jobs, unsigned const count);
+
+/**
+ * Extends committed prefix of journaled file by written buffer of job (if it continues prefix) and rewrites journal.
+ *
+ * @param job Written job with buffer.
+ */
+static void writer_commit(struct writer_job const *const job);
+
+/**
+ * Returns buffers of written jobs for reuse and closes files (all their writes are done).
+ *
+ * @param writer Writer.
+ * @param jobs Jobs.
+ * @param count Number of jobs.
+ */
+static void writer_finish(struct writer *const writer, struct writer_job const *const jobs, unsigned const count);
+
+
+struct writer *writer_start(char const *const name, unsigned long long const direct_size, int const uring) {
+    struct writer *writer;
+
+    if (!(writer = calloc(1, sizeof(struct writer)))) {
+        err_handle("failed to allocate writer", EXIT);
+    }
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->queued, NULL);
+    pthread_cond_init(&writer->taken, NULL);
+    writer->direct_size = direct_size;
+    writer->uring = uring;
+    snprintf(writer->name, sizeof(writer->name), "%s", name);
+    if ((errno = pthread_create(&writer->thread, NULL, writer_thread, writer))) {
+        err_handle("writer thread creation failed", EXIT);
+    }
+
+    return writer;
+}
+
+struct writer_file *writer_open(struct writer *const writer, int const fd, char const *const path, unsigned long long const size) {
+    struct writer_file *file;
+
+    if (!(file = malloc(sizeof(struct writer_file)))) {
+        return NULL;
+    }
+    if (!(file->path = strdup(path))) {
+        free(file);
+        return NULL;
+    }
+    file->writer = writer;
+    file->fd = fd;
+    file->failed = 0;
+    file->direct_fd = -1;
+    file->journal_fd = -1;
+
+    // File system might not support direct writes, then file is written through page cache
+    if (writer->direct_size && size >= writer->direct_size && (file->direct_fd = open(path, O_WRONLY | O_DIRECT)) == -1) {
+        errno = 0;
+    }
+
+    return file;
+}
+
+void writer_journal(struct writer_file *const file, int const fd, struct journal_record const *const record) {
+    file->journal_fd = fd;
+    file->journal = *record;
+}
+
+char *writer_buffer(struct writer *const writer) {
+    char *buf = NULL;
+
+    pthread_mutex_lock(&writer->lock);
+    if (writer->free_count) {
+        buf = writer->free_bufs[--writer->free_count];
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    if (!buf && (errno = posix_memalign((void **) &buf, WRITER_ALIGN, WRITER_BUF))) {
+        return NULL;
+    }
+
+    return buf;
+}
+
+void writer_submit(struct writer_file *const file, char *const buf, unsigned const len, long const pos) {
+    struct writer_job const job = {file, buf, len, pos};
+
+    writer_push(&job);
+}
+
+int writer_failed(struct writer_file *const file) {
+    return __atomic_load_n(&file->failed, __ATOMIC_ACQUIRE);
+}
+
+void writer_close(struct writer_file *const file) {
+    struct writer_job const job = {file, NULL, 0, 0};
+
+    writer_push(&job);
+}
+
+static void writer_push(struct writer_job const *const job) {
+    struct writer *const writer = job->file->writer;
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->count == WRITER_QUEUE) {
+        pthread_cond_wait(&writer->taken, &writer->lock);
+    }
+    writer->jobs[(writer->head + writer->count++) % WRITER_QUEUE] = *job;
+    pthread_cond_signal(&writer->queued);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+static void *writer_thread(void *const arg) {
+    struct writer *const writer = arg;
+    struct writer_job jobs[WRITER_QUEUE];
+    struct uring uring;
+
+    metrics_register(writer->name);
+
+    // io_uring instance is used only by this thread
+    int const uring_ok = writer->uring && !uring_init(&uring, WRITER_QUEUE);
+    if (writer->uring && !uring_ok) {
+        err_handle("io_uring is not supported, files are written by pwrite", WARNING);
+    }
+
+    // Jobs are taken in batches, files closed in batch are closed after all its writes
+    for (;;) {
+        unsigned const count = writer_take(writer, jobs);
+        if (uring_ok) {
+            writer_write_uring(&uring, jobs, count);
+        } else {
+            for (unsigned i = 0; i < count; i++) {
+                if (jobs[i].buf) {
+                    writer_write(jobs + i);
+                }
+            }
+        }
+        writer_finish(writer, jobs, count);
+    }
+
+    return NULL;
+}
+
+static unsigned writer_take(struct writer *const writer, struct writer_job *const jobs) {
+    pthread_mutex_lock(&writer->lock);
+    while (!writer->count) {
+        pthread_cond_wait(&writer->queued, &writer->lock);
+    }
+    unsigned const count = writer->count;
+    for (unsigned i = 0; i < count; i++) {
+        jobs[i] = writer->jobs[(writer->head + i) % WRITER_QUEUE];
+    }
+    writer->head = (writer->head + count) % WRITER_QUEUE;
+    writer->count = 0;
+    pthread_cond_broadcast(&writer->taken);
+    pthread_mutex_unlock(&writer->lock);
+
+    return count;
+}
+
+static void writer_write_uring(struct uring *const uring, struct writer_job const *const jobs, unsigned const count) {
+    struct io_uring_cqe *cqe;
+    unsigned submitted = 0;
+
+    for (unsigned i = 0; i < count; i++) {
+        if (jobs[i].buf && !writer_failed(jobs[i].file)) {
+            uring_prep_write(uring, writer_fd(jobs[i].file, jobs[i].pos, jobs[i].len), jobs[i].buf, jobs[i].len, jobs[i].pos, i);
+            submitted++;
+        }
+    }
+    while (submitted) {
+        if (uring_submit(uring, 1, -1)) {
+            err_handle("io_uring wait failed", EXIT);
+        }
+        while (submitted && (cqe = uring_cqe(uring))) {
+            struct writer_job const *const job = jobs + cqe->user_data;
+            int const ret = cqe->res;
+            uring_seen(uring);
+            submitted--;
+
+            // Rest of short write (or whole failed write) is written synchronously
+            if (ret > 0) {
+                metrics_count(METRIC_WRITTEN, ret);
+            }
+            if (ret < 0) {
+                writer_write(job);
+            } else if ((unsigned) ret < job->len) {
+                struct writer_job const rest = {job->file, job->buf + ret, job->len - ret, job->pos + ret};
+                writer_write(&rest);
+            }
+        }
+    }
+}
+
+static void writer_finish(struct writer *const writer, struct writer_job const *const jobs, unsigned const count) {
+    for (unsigned i = 0; i < count; i++) {
+        // Close file (all its writes were done before), journal of completed file is not needed anymore
+        if (!jobs[i].buf) {
+            struct writer_file *const file = jobs[i].file;
+            if (file->journal_fd != -1) {
+                close(file->journal_fd);
+                if (!writer_failed(file) && file->journal.committed == file->journal.size) {
+                    journal_remove(file->path);
+                }
+            }
+            if (jobs[i].file->direct_fd != -1) {
+                close(jobs[i].file->direct_fd);
+            }
+            close(jobs[i].file->fd);
+            free(jobs[i].file->path);
+            free(jobs[i].file);
+            continue;
+        }
+
+        // Return buffer for reuse
+        if (jobs[i].file->journal_fd != -1) {
+            writer_commit(jobs + i);
+        }
+        pthread_mutex_lock(&writer->lock);
+        if (writer->free_count < WRITER_QUEUE) {
+            writer->free_bufs[writer->free_count++] = jobs[i].buf;
+        } else {
+            free(jobs[i].buf);
+        }
+        pthread_mutex_unlock(&writer->lock);
+    }
+}
+
+static void writer_commit(struct writer_job const *const job) {
+    struct writer_file *const file = job->file;
+
+    // Journal is not synchronized with data, so it is valid after crash of receiver, not after crash of system
+    if (writer_failed(file) || (unsigned long long) job->pos != file->journal.committed) {
+        return;
+    }
+    file->journal.crc = crc32(file->journal.crc, (Bytef *) job->buf, job->len);
+    file->journal.committed += job->len;
+    if (journal_write(file->journal_fd, &file->journal)) {
+        errno = 0;
+    }
+}
+
+static int writer_fd(struct writer_file const *const file, long const pos, unsigned const len) {
+    return file->direct_fd != -1 && !(pos % WRITER_ALIGN) && !(len % WRITER_ALIGN) ? file->direct_fd : file->fd;
+}
+
+static void writer_write(struct writer_job const *const job) {
+    struct writer_file *const file = job->file;
+    unsigned written = 0;
+
+    // Nothing more is written into file, which failed already
+    if (writer_failed(file)) {
+        return;
+    }
+
+    while (written < job->len) {
+        int const fd = writer_fd(file, job->pos + written, job->len - written);
+        int const direct = fd == file->direct_fd;
+        ssize_t const ret = pwrite(fd, job->buf + written, job->len - written, job->pos + written);
+        metrics_count(METRIC_SYSCALLS, 1);
+        if (ret < 0 && errno == EINTR) {
+            errno = 0;
+            continue;
+        }
+        if (ret < 0 && direct && errno == EINVAL) { // direct write is not supported for this file, page cache is used
+            close(file->direct_fd);
+            file->direct_fd = -1;
+            errno = 0;
+            continue;
+        }
+        if (ret <= 0) { // cannot write to file
+            char *msg2 = ": failed to write";
+            char msg1[strlen(file->path) + strlen(msg2) + 1];
+            strcpy(msg1, file->path);
+            strcat(msg1, msg2);
+            err_handle(msg1, WARNING);
+            __atomic_store_n(&file->failed, 1, __ATOMIC_RELEASE);
+            return;
+        }
+        written += ret;
+        metrics_count(METRIC_WRITTEN, ret);
+    }
+}
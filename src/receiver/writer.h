@@ -0,0 +1,135 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Receiver's write-behind of output files (buffers are written by background thread of every worker).
+ * @details header file
+ */
+
+// GUARD
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <pthread.h>
+
+#include "journal.h"
+
+/// Size of one write buffer
+#define WRITER_BUF (1 << 20)
+
+/// Alignment of write buffers (and of offsets and lengths written with O_DIRECT)
+#define WRITER_ALIGN 4096
+
+/// Maximum number of buffers queued for writing (session submitting another one waits until disk catches up)
+#define WRITER_QUEUE 64
+
+/// Queued write of buffer, or closing of file (buffer is NULL)
+struct writer_job {
+    struct writer_file *file; // output file
+    char *buf; // buffer of data, NULL if file has to be closed
+    unsigned len; // length of data
+    long pos; // offset of data in file
+};
+
+/**
+ * Writer of one worker. Its thread writes files of sessions of the worker only, so workers do not share any lock (queue
+ * of jobs and free buffers are guarded by lock shared only by the worker and its writer thread).
+ */
+struct writer {
+    pthread_t thread; // writer thread
+    pthread_mutex_t lock; // lock of queue and free buffers
+    pthread_cond_t queued; // signals job queued
+    pthread_cond_t taken; // signals job taken from full queue
+    struct writer_job jobs[WRITER_QUEUE]; // ring of queued jobs
+    unsigned head; // index of the oldest job
+    unsigned count; // number of queued jobs
+    char *free_bufs[WRITER_QUEUE]; // buffers returned by writer thread
+    unsigned free_count; // number of free buffers
+    unsigned long long direct_size; // minimal size of file written with O_DIRECT, zero if disabled
+    int uring; // non-zero if io_uring is requested
+    char name[16]; // value of label 'thread' of metrics of writer thread
+};
+
+/**
+ * Output file written by writer thread. It is owned by session until 'writer_close()', then by writer thread, which
+ * closes it after all queued writes.
+ */
+struct writer_file {
+    struct writer *writer; // writer of file
+    int fd; // file descriptor
+    int direct_fd; // file descriptor of the same file opened with O_DIRECT, -1 if direct writing is not used
+    int failed; // set by writer thread if some write failed (read atomically)
+    char *path; // path of file for error messages (allocated)
+    int journal_fd; // progress journal file descriptor, -1 if progress of file is not journaled
+    struct journal_record journal; // record of journal (updated by writer thread)
+};
+
+/**
+ * Allocates writer and starts its thread (exits program on failure).
+ *
+ * @param name Value of label 'thread' of metrics of writer thread.
+ * @param direct_size Files of at least this size are written with O_DIRECT (aligned blocks), zero disables it.
+ * @param uring Non-zero if all queued buffers are written by one io_uring submission (falls back to 'pwrite()' if
+ * kernel does not support it).
+ * @return Writer.
+ */
+struct writer *writer_start(char const *const name, unsigned long long const direct_size, int const uring);
+
+/**
+ * Takes ownership of opened output file.
+ *
+ * @param writer Writer, which writes file.
+ * @param fd Output file descriptor.
+ * @param path Path of file.
+ * @param size Announced size of file (zero if unknown), large file is also opened for direct writing.
+ * @return Output file, or NULL if allocation failed (file descriptor is not closed then).
+ */
+struct writer_file *writer_open(struct writer *const writer, int const fd, char const *const path, unsigned long long const size);
+
+/**
+ * Attaches progress journal to file. Writer thread extends committed prefix of record by every written buffer, which
+ * continues it, and rewrites journal after it. Journal is removed after closing of file, whose whole announced size was
+ * committed. Has to be called before the first buffer of file is submitted.
+ *
+ * @param file Output file.
+ * @param fd Journal file descriptor (owned by file since now).
+ * @param record Record of journal, committed prefix ends at offset of the first submitted buffer.
+ */
+void writer_journal(struct writer_file *const file, int const fd, struct journal_record const *const record);
+
+/**
+ * Takes free aligned buffer of WRITER_BUF bytes.
+ *
+ * @param writer Writer, to which buffer is submitted.
+ * @return Buffer, or NULL if allocation failed.
+ */
+char *writer_buffer(struct writer *const writer);
+
+/**
+ * Queues buffer to be written into file at offset and takes its ownership. Waits only if WRITER_QUEUE buffers are
+ * queued already.
+ *
+ * @param file Output file.
+ * @param buf Buffer taken by 'writer_buffer()' of writer of file.
+ * @param len Length of data in buffer.
+ * @param pos Offset of data in file.
+ */
+void writer_submit(struct writer_file *const file, char *const buf, unsigned const len, long const pos);
+
+/**
+ * Checks whether some write of file failed.
+ *
+ * @param file Output file.
+ * @return Non-zero if write failed (error was already reported).
+ */
+int writer_failed(struct writer_file *const file);
+
+/**
+ * Queues closing of file behind its writes. File must not be used anymore.
+ *
+ * @param file Output file.
+ */
+void writer_close(struct writer_file *const file);
+
+// END GUARD
+#endif
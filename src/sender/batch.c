@@ -0,0 +1,199 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's batch of files transferred one after another over one connection.
+ */
+
+#define _GNU_SOURCE // getline(), scandir()
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "../common/err.h"
+
+/**
+ * Joins two parts of path by '/'.
+ *
+ * @param dir Directory part.
+ * @param name Name part.
+ * @return Joined path (allocated).
+ */
+static char *batch_join(char const *const dir, char const *const name);
+
+/**
+ * Checks, whether path contains '..' component.
+ *
+ * @param path Path.
+ * @return Non-zero if some component of path is '..'.
+ */
+static int batch_parent(char const *const path);
+
+/**
+ * Appends file to batch.
+ *
+ * @param batch Batch.
+ * @param src Path of source file (taken by batch).
+ * @param dst Destination path of file (taken by batch).
+ */
+static void batch_add(struct batch *const batch, char *const src, char *const dst);
+
+/**
+ * Appends regular files of directory and of its subdirectories to batch.
+ *
+ * @param batch Batch.
+ * @param src Path of source directory.
+ * @param dst Destination path of directory.
+ * @return Zero on success, non-zero if some directory cannot be read (errno is set).
+ */
+static int batch_dir(struct batch *const batch, char const *const src, char const *const dst);
+
+
+int batch_list(struct batch *const batch, char const *const LIST, char const *const DST_DIRPATH) {
+    FILE *const list = strcmp(LIST, "-") ? fopen(LIST, "r") : stdin;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    memset(batch, 0, sizeof(struct batch));
+    if (!list) {
+        return 1;
+    }
+    while ((len = getline(&line, &size, list)) != -1) {
+        while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (!len) {
+            continue;
+        }
+
+        // Listed path is kept below destination directory
+        char const *name = line;
+        while (*name == '/' || (name[0] == '.' && name[1] == '/')) {
+            name += *name == '/' ? 1 : 2;
+        }
+        if (batch_parent(name)) {
+            char *msg2 = ": path of listed file leaves destination directory";
+            char msg1[len + strlen(msg2) + 1];
+            strcpy(msg1, line);
+            strcat(msg1, msg2);
+            err_handle(msg1, WARNING);
+            batch->rejected++;
+            continue;
+        }
+        char *const src = strdup(line);
+        if (!src) {
+            err_handle("failed to allocate path of file of batch", EXIT);
+        }
+        batch_add(batch, src, batch_join(DST_DIRPATH, name));
+    }
+    int const error = ferror(list);
+    free(line);
+    if (list != stdin) {
+        fclose(list);
+    }
+    if (!error) {
+        errno = 0; // end of list
+    }
+
+    return error;
+}
+
+int batch_tree(struct batch *const batch, char const *const SRC_DIRPATH, char const *const DST_DIRPATH) {
+    memset(batch, 0, sizeof(struct batch));
+
+    return batch_dir(batch, SRC_DIRPATH, DST_DIRPATH);
+}
+
+void batch_free(struct batch *const batch) {
+    for (unsigned i = 0; i < batch->count; i++) {
+        free(batch->files[i].src);
+        free(batch->files[i].dst);
+    }
+    free(batch->files);
+}
+
+static int batch_dir(struct batch *const batch, char const *const src, char const *const dst) {
+    struct dirent **entries;
+    struct stat st;
+    int ret = 0;
+
+    int const count = scandir(src, &entries, NULL, alphasort);
+    if (count < 0) {
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        char const *const name = entries[i]->d_name;
+        if (ret || !strcmp(name, ".") || !strcmp(name, "..")) {
+            free(entries[i]);
+            continue;
+        }
+
+        // Subdirectories are entered, symbolic links are followed only to files
+        char *const src_path = batch_join(src, name);
+        char *const dst_path = batch_join(dst, name);
+        if (!lstat(src_path, &st) && S_ISDIR(st.st_mode)) {
+            ret = batch_dir(batch, src_path, dst_path);
+            free(src_path);
+            free(dst_path);
+        } else if (!stat(src_path, &st) && S_ISREG(st.st_mode)) {
+            batch_add(batch, src_path, dst_path);
+        } else { // other files (and broken links) are skipped
+            errno = 0;
+            free(src_path);
+            free(dst_path);
+        }
+        free(entries[i]);
+    }
+    free(entries);
+
+    return ret;
+}
+
+static int batch_parent(char const *const path) {
+    for (char const *cur = path; *cur; cur++) {
+        // Component starts at beginning of path or behind '/' and ends by '/' or end of path
+        if ((cur == path || cur[-1] == '/') && cur[0] == '.' && cur[1] == '.' && (cur[2] == '/' || !cur[2])) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void batch_add(struct batch *const batch, char *const src, char *const dst) {
+    if (batch->count == batch->capacity) {
+        unsigned const capacity = batch->capacity ? batch->capacity * 2 : 64;
+        struct batch_file *const files = realloc(batch->files, capacity * sizeof(struct batch_file));
+        if (!files) {
+            err_handle("failed to allocate files of batch", EXIT);
+        }
+        batch->files = files;
+        batch->capacity = capacity;
+    }
+    batch->files[batch->count].src = src;
+    batch->files[batch->count].dst = dst;
+    batch->count++;
+}
+
+static char *batch_join(char const *const dir, char const *const name) {
+    size_t const dir_len = strlen(dir);
+    int const slash = dir_len && dir[dir_len - 1] != '/';
+    char *const path = malloc(dir_len + slash + strlen(name) + 1);
+
+    if (!path) {
+        err_handle("failed to allocate path of file of batch", EXIT);
+    }
+    memcpy(path, dir, dir_len);
+    if (slash) {
+        path[dir_len] = '/';
+    }
+    strcpy(path + dir_len + slash, name);
+
+    return path;
+}
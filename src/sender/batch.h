@@ -0,0 +1,58 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's batch of files transferred one after another over one connection.
+ * @details header file
+ */
+
+// GUARD
+#ifndef BATCH_H
+#define BATCH_H
+
+/// Source file of batch
+struct batch_file {
+    char *src; // path of source file (allocated)
+    char *dst; // destination path of file on receiver's side (allocated)
+};
+
+/// Files of batch in order of their transfer
+struct batch {
+    struct batch_file *files; // array of files (allocated)
+    unsigned count; // number of files
+    unsigned capacity; // number of files, for which array is allocated
+    unsigned rejected; // number of listed files, which were not added (their path leaves destination directory)
+};
+
+/**
+ * Reads list of source files, one path per line (empty lines are skipped). Every file is received into destination
+ * directory under its listed path (leading '/' and './' are dropped). Path containing '..' component would leave
+ * destination directory, so its file is rejected (reported and counted, not added to batch).
+ *
+ * @param batch Batch to be initialized.
+ * @param LIST Path of list, '-' for standard input.
+ * @param DST_DIRPATH Destination directory path on receiver's side.
+ * @return Zero on success, non-zero if list cannot be read (errno is set).
+ */
+int batch_list(struct batch *const batch, char const *const LIST, char const *const DST_DIRPATH);
+
+/**
+ * Collects regular files of directory tree (in alphabetical order of every directory, symbolic links to directories are
+ * not followed). Every file is received into destination directory under its path relative to source directory.
+ *
+ * @param batch Batch to be initialized.
+ * @param SRC_DIRPATH Source directory path.
+ * @param DST_DIRPATH Destination directory path on receiver's side.
+ * @return Zero on success, non-zero if some directory cannot be read (errno is set).
+ */
+int batch_tree(struct batch *const batch, char const *const SRC_DIRPATH, char const *const DST_DIRPATH);
+
+/**
+ * Frees all files of batch.
+ *
+ * @param batch Batch.
+ */
+void batch_free(struct batch *const batch);
+
+// END GUARD
+#endif
@@ -5,20 +5,41 @@
  * @Program Client implementation
  */
 
+#define _GNU_SOURCE // sendmmsg(), recvmmsg()
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
 
-#include "../common/base16.h"
+#include "../common/codec.h"
+#include "../common/name.h"
 #include "../common/err.h"
 #include "../common/definitions.h"
 #include "../common/arguments.h"
+#include "../common/log.h"
 #include "dns_sender_events.h"
 #include "../common/events.h"
+#include "../common/protocol.h"
+#include "window.h"
+#include "pipeline.h"
+#include "template.h"
+#include "input.h"
+#include "batch.h"
+
+/// Range of source file transferred by one connection of parallel transfer
+struct range {
+    unsigned long long start; // offset of first byte
+    unsigned long long end; // offset behind last byte
+    unsigned long long size; // size of whole file
+};
 
 /**
  * Runs client and transfer file to server.
@@ -28,8 +49,182 @@
  * @param DST_FILEPATH Destination filepath program argument.
  * @param SRC_FILEPATH Source filepath program argument.
  * @param MILLISECONDS Milliseconds program argument.
+ * @param TRANSPORT Transport program argument.
+ * @param BATCH Batch program argument.
+ * @param CODEC Codec program argument.
+ * @param QUESTIONS Questions program argument.
+ * @param CONNECTIONS Connections program argument.
+ * @param LEVEL Compression level program argument.
+ * @param RESUME Resume program argument (NULL if not present).
+ * @param WINDOW Window program argument.
+ * @param LIST List program argument (NULL if not present).
+ * @param LOG_LEVEL Log level program argument.
+ * @param PORT_NUMBER Port program argument.
+ */
+void client(char *const UPSTREAM_DNS_IP, char *const BASE_HOST, char *const DST_FILEPATH, char *const SRC_FILEPATH, char *const MILLISECONDS, char *const TRANSPORT, char *const BATCH, char *const CODEC, char *const QUESTIONS, char *const CONNECTIONS, char *const LEVEL, char *const RESUME, char *const WINDOW, char *const LIST, char *const LOG_LEVEL, char *const PORT_NUMBER);
+
+/**
+ * Creates socket and connects it to the first reachable DNS server.
+ *
+ * @param name_servers Addresses of DNS servers.
+ * @param name_servers_count Number of addresses.
+ * @param udp Non-zero if UDP socket is created (only associated with the first server), zero for TCP.
+ * @param port Port of DNS servers.
+ * @param servaddr Address of server to be filled (it is referenced by event data).
+ * @return Connected socket file descriptor.
+ */
+int connect_server(char name_servers[MAX_NAME_SERVERS][MAX_IPv4_LENGTH], int const name_servers_count, int const udp, unsigned short const port, struct sockaddr_in *const servaddr);
+
+/**
+ * Transfers file over 'connections' TCP connections in parallel. File is split into ranges of whole chunks, every range
+ * is transferred by its own process over its own connection (separate session of receiver), chunks carry their file
+ * offsets, so receiver writes them into the same file.
+ *
+ * @param name_servers Addresses of DNS servers.
+ * @param name_servers_count Number of addresses.
+ * @param port Port of DNS servers.
+ * @param template Template of packets of session.
+ * @param DST_FILEPATH Destination filepath program argument.
+ * @param input Mapped source file (every process reads its range straight from mapping).
+ * @param MILLISECONDS Milliseconds program argument.
+ * @param BATCH Batch program argument.
+ * @param QUESTIONS Questions program argument.
+ * @param codec Codec of chunks.
+ * @param connections Number of connections.
+ */
+void transfer_parallel(char name_servers[MAX_NAME_SERVERS][MAX_IPv4_LENGTH], int const name_servers_count, unsigned short const port, struct template *const template, char *const DST_FILEPATH, struct input *const input, char *const MILLISECONDS, char *const BATCH, char *const QUESTIONS, struct codec const *const codec, unsigned const connections);
+
+/**
+ * Transfers path (or hello) and file over connected TCP socket (data are delivered in order by TCP), see 'tcp_file()'.
+ * Plain transfer (base16 codec, whole uncompressed file, no resume) is sent as legacy transfer, which legacy receivers
+ * understand, and it is ended by closing of sending side of connection. Connection is closed as soon as receiver
+ * acknowledges end of file, or closes connection itself (or after 'MILLISECONDS' without either of them).
+ *
+ * @param sockfd Connected socket file descriptor.
+ * @param template Template of packets of session.
+ * @param DST_FILEPATH Destination filepath program argument.
+ * @param input Input of file to be transferred.
+ * @param MILLISECONDS Milliseconds program argument (maximum time of waiting for acknowledgement of end of file).
+ * @param BATCH Batch program argument.
+ * @param QUESTIONS Questions program argument.
+ * @param codec Codec of chunks.
+ * @param range Range of file transferred by connection of parallel transfer ('input' is restricted to it), or NULL
+ * if whole file is transferred.
+ * @param resume Non-zero if transfer is resumed (input is mapped, 'range' is NULL).
+ */
+void transfer_tcp(int const sockfd, struct template *const template, char *const DST_FILEPATH, struct input *const input, char *const MILLISECONDS, char *const BATCH, char *const QUESTIONS, struct codec const *const codec, struct range const *const range, int const resume);
+
+/**
+ * Transfers files of batch one after another over connected TCP socket, every file starts by its own hello and ends by
+ * end of file mark, so receiver switches output files within one session. Source file, which cannot be opened, is
+ * skipped (rest of batch is transferred, then program exits with failure, as it does if some listed file was
+ * rejected). Acknowledgements of ends of files are read as they come, connection is closed as soon as all of them are
+ * read (or after 'MILLISECONDS' without another one).
+ *
+ * @param sockfd Connected socket file descriptor.
+ * @param template Template of packets of session.
+ * @param batch Files of batch.
+ * @param MILLISECONDS Milliseconds program argument (maximum time of waiting for acknowledgement of end of file).
+ * @param BATCH Batch program argument.
+ * @param QUESTIONS Questions program argument.
+ * @param codec Codec of chunks.
+ * @param level Compression level of files, zero if they are not compressed.
+ */
+void transfer_batch(int const sockfd, struct template *const template, struct batch const *const batch, char *const MILLISECONDS, char *const BATCH, char *const QUESTIONS, struct codec const *const codec, int const level);
+
+/**
+ * Builds hello, chunks and end of file mark of file into pipeline, which is flushed whenever it is full (the last batch
+ * is left in it), legacy transfer is built of legacy path packet and chunks only. Chunks are written in batches of
+ * 'BATCH' chunks, every packet carries up to 'QUESTIONS' of them. If
+ * 'range' is set, only range of file is sent by chunks prefixed with their file offset (announced by hello together with
+ * size of file). Resumed transfer waits for progress of file answering hello and skips prefix of file already written
+ * by receiver.
+ *
+ * @param pipeline Pipeline of connection (initialized with 'BATCH').
+ * @param template Template of packets of session.
+ * @param DST_FILEPATH Destination filepath of file.
+ * @param input Input of file to be transferred.
+ * @param QUESTIONS Questions program argument.
+ * @param codec Codec of chunks.
+ * @param range Range of file transferred by connection of parallel transfer, or NULL if whole file is transferred.
+ * @param resume Non-zero if transfer is resumed.
+ * @param legacy Non-zero if file is sent as legacy transfer (base16 codec, 'range' is NULL, no compression, no resume).
+ */
+void tcp_file(struct pipeline *const pipeline, struct template *const template, char *const DST_FILEPATH, struct input *const input, char *const QUESTIONS, struct codec const *const codec, struct range const *const range, int const resume, int const legacy);
+
+/**
+ * Reads acknowledgements of ends of files from connection, until expected number of them is read, or no response comes
+ * in time.
+ *
+ * @param sockfd Connected socket file descriptor.
+ * @param files Number of expected acknowledgements.
+ * @param timeout Maximum time of waiting for next response in milliseconds (zero reads only already received ones).
+ * @return Number of read acknowledgements of ends of files.
+ */
+unsigned tcp_done(int const sockfd, unsigned const files, long long const timeout);
+
+/**
+ * Reads one response of receiver (prefixed length and DNS packet) from connection.
+ *
+ * @param sockfd Connected socket file descriptor.
+ * @param response Buffer of at least DNS_TCP + PROTO_MAX_RESPONSE bytes.
+ * @param timeout Maximum time of waiting for whole response in milliseconds.
+ * @return Length of DNS response (without prefixed length), zero if it was not received in time (or connection was
+ * closed), -1 if it is too long.
+ */
+int tcp_response(int const sockfd, char *const response, long long const timeout);
+
+/**
+ * Waits for response of receiver carrying progress of file (answer to hello of resumed transfer) and skips committed
+ * prefix of input, if its checksum matches.
+ *
+ * @param sockfd Connected socket file descriptor.
+ * @param input Mapped input of file.
+ * @return Offset from which file is sent (committed bytes, or zero if prefix differs or nothing was committed).
+ */
+unsigned long long tcp_resume(int const sockfd, struct input *const input);
+
+/**
+ * Writes batch of packets of pipeline to connection and reports its chunks as sent.
+ *
+ * @param pipeline Pipeline of packets.
+ */
+void tcp_flush(struct pipeline *const pipeline);
+
+/**
+ * Transfers hello and file over connected UDP socket. Every chunk carries sequence number, chunks are sent in batches
+ * by sliding window and retransmitted until acknowledged by receiver (after timeout following measured round-trip
+ * time).
+ *
+ * @param sockfd Connected socket file descriptor.
+ * @param template Template of packets of session.
+ * @param DST_FILEPATH Destination filepath program argument.
+ * @param input Input of file to be transferred.
+ * @param codec Codec of chunks.
+ * @param in_flight Maximum number of chunks in flight.
  */
-void client(char *const UPSTREAM_DNS_IP, char *const BASE_HOST, char *const DST_FILEPATH, char *const SRC_FILEPATH, char *const MILLISECONDS);
+void transfer_udp(int const sockfd, struct template *const template, char *const DST_FILEPATH, struct input *const input, struct codec const *const codec, unsigned const in_flight);
+
+/**
+ * Sends all chunks of window, which were not sent yet or whose retransmission timeout expired, with as few system
+ * calls as possible. Retransmission of the oldest chunk backs off timeout of window. Chunks further than PROTO_SACK
+ * ahead of the oldest one are not retransmitted (acknowledgement cannot tell they were received, until window slides
+ * closer to them).
+ *
+ * @param sockfd Connected UDP socket file descriptor.
+ * @param window Window of chunks.
+ */
+void udp_send_window(int const sockfd, struct window *const window);
+
+/**
+ * Waits at most 'timeout' milliseconds for responses of receiver and processes all received acknowledgements.
+ *
+ * @param sockfd Connected UDP socket file descriptor.
+ * @param window Window of chunks, NULL if any acknowledgement is awaited (hello).
+ * @param timeout Maximum time of waiting in milliseconds.
+ * @return Number of received acknowledgements (PROTO_ACK_DONE flag makes it negative).
+ */
+int udp_receive_acks(int const sockfd, struct window *const window, int const timeout);
 
 /**
  * Parses arguments of program and sets their addresses to the passed pointers (or default values for not present
@@ -41,8 +236,20 @@ void client(char *const UPSTREAM_DNS_IP, char *const BASE_HOST, char *const DST_
  * @param BASE_HOST Pointer to which save BASE_HOST positional argument.
  * @param DST_FILEPATH Pointer to which save DST_FILEPATH positional argument.
  * @param SRC_FILEPATH Pointer to which save SRC_FILEPATH optional positional argument.
+ * @param MILLISECONDS Pointer to which save MILLISECONDS optional argument.
+ * @param TRANSPORT Pointer to which save TRANSPORT optional argument.
+ * @param BATCH Pointer to which save BATCH optional argument.
+ * @param CODEC Pointer to which save CODEC optional argument.
+ * @param QUESTIONS Pointer to which save QUESTIONS optional argument.
+ * @param CONNECTIONS Pointer to which save CONNECTIONS optional argument.
+ * @param LEVEL Pointer to which save LEVEL optional argument.
+ * @param RESUME Pointer to which save RESUME optional flag (NULL if not present).
+ * @param WINDOW Pointer to which save WINDOW optional argument.
+ * @param LIST Pointer to which save LIST optional argument (NULL if not present).
+ * @param LOG_LEVEL Pointer to which save LOG_LEVEL optional argument.
+ * @param PORT_NUMBER Pointer to which save PORT optional argument.
  */
-void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP, char **const BASE_HOST, char **const DST_FILEPATH, char **const SRC_FILEPATH, char **const MILLISECONDS);
+void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP, char **const BASE_HOST, char **const DST_FILEPATH, char **const SRC_FILEPATH, char **const MILLISECONDS, char **const TRANSPORT, char **const BATCH, char **const CODEC, char **const QUESTIONS, char **const CONNECTIONS, char **const LEVEL, char **const RESUME, char **const WINDOW, char **const LIST, char **const LOG_LEVEL, char **const PORT_NUMBER);
 
 /**
  * Checks, if values of passed program arguments by user are valid.
@@ -50,29 +257,20 @@ void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP,
  * @param UPSTREAM_DNS_IP Upstream DNS IP program argument.
  * @param BASE_HOST Base host of server program argument.
  * @param MILLISECONDS Milliseconds program argument.
+ * @param TRANSPORT Transport program argument.
+ * @param BATCH Batch program argument.
+ * @param CODEC Codec program argument.
+ * @param QUESTIONS Questions program argument.
+ * @param CONNECTIONS Connections program argument.
+ * @param LEVEL Compression level program argument.
+ * @param RESUME Resume program argument.
+ * @param WINDOW Window program argument.
+ * @param LIST List program argument.
+ * @param SRC_FILEPATH Source filepath program argument.
+ * @param LOG_LEVEL Log level program argument.
+ * @param PORT_NUMBER Port program argument.
  */
-void arg_check(char const *const UPSTREAM_DNS_IP, char const *const BASE_HOST, char const *const MILLISECONDS);
-
-/**
- * Encodes name section of DNS question into valid DNS coding (www.google.com -> 3www6google3com0)
- *
- * @param buf Destination buffer.
- * @param str Source string.
- */
-void name_encode(char *const buf, char const *const str);
-
-/**
- * Puts data into DNS valid packet.
- *
- * DNS ID is set to client process ID. Recursion desired flag is set to true.
- *
- * @param data Raw data (possibly data chunk) to be encoded into DNS packet.
- * @param data_len Raw data's length in bytes.
- * @param BASE_HOST Base host of server program argument.
- * @param buf Buffer to which output DNS packet is constructed.
- * @return
- */
-short build_dns_packet(char const *const data, short const data_len, char *const BASE_HOST, char *const buf);
+void arg_check(char const *const UPSTREAM_DNS_IP, char const *const BASE_HOST, char const *const MILLISECONDS, char const *const TRANSPORT, char const *const BATCH, char const *const CODEC, char const *const QUESTIONS, char const *const CONNECTIONS, char const *const LEVEL, char const *const RESUME, char const *const WINDOW, char const *const LIST, char const *const SRC_FILEPATH, char const *const LOG_LEVEL, char const *const PORT_NUMBER);
 
 /**
  * Get configured default name servers of system and save them into array of strings 'name_servers'. If
@@ -92,58 +290,129 @@ struct event event;
 
 int main(int const argc, char *const argv[]) {
     // Parse and check program arguments
-    char *UPSTREAM_DNS_IP, *BASE_HOST, *DST_FILEPATH, *SRC_FILEPATH, *MILLISECONDS;
-    arg_parse(argc, argv, &UPSTREAM_DNS_IP, &BASE_HOST, &DST_FILEPATH, &SRC_FILEPATH, &MILLISECONDS);
-    arg_check(UPSTREAM_DNS_IP, BASE_HOST, MILLISECONDS);
+    char *UPSTREAM_DNS_IP, *BASE_HOST, *DST_FILEPATH, *SRC_FILEPATH, *MILLISECONDS, *TRANSPORT, *BATCH, *CODEC, *QUESTIONS, *CONNECTIONS, *LEVEL, *RESUME, *WINDOW, *LIST, *LOG_LEVEL, *PORT_NUMBER;
+    arg_parse(argc, argv, &UPSTREAM_DNS_IP, &BASE_HOST, &DST_FILEPATH, &SRC_FILEPATH, &MILLISECONDS, &TRANSPORT, &BATCH, &CODEC, &QUESTIONS, &CONNECTIONS, &LEVEL, &RESUME, &WINDOW, &LIST, &LOG_LEVEL, &PORT_NUMBER);
+    arg_check(UPSTREAM_DNS_IP, BASE_HOST, MILLISECONDS, TRANSPORT, BATCH, CODEC, QUESTIONS, CONNECTIONS, LEVEL, RESUME, WINDOW, LIST, SRC_FILEPATH, LOG_LEVEL, PORT_NUMBER);
 
     // Run client
-    client(UPSTREAM_DNS_IP, BASE_HOST, DST_FILEPATH, SRC_FILEPATH, MILLISECONDS);
+    client(UPSTREAM_DNS_IP, BASE_HOST, DST_FILEPATH, SRC_FILEPATH, MILLISECONDS, TRANSPORT, BATCH, CODEC, QUESTIONS, CONNECTIONS, LEVEL, RESUME, WINDOW, LIST, LOG_LEVEL, PORT_NUMBER);
 
     return 0;
 }
 
-void client(char *const UPSTREAM_DNS_IP, char *const BASE_HOST, char *const DST_FILEPATH, char *const SRC_FILEPATH, char *const MILLISECONDS) {
-    char dns[DNS_MAX_PACKET]; // DNS packet buffer
-    char chunk[(DNS_MAX_NAME - strlen(BASE_HOST) - MAX_DOTS) / 2]; // data buffer (2 stands for b16 encoding overhead)
-    int sockfd;
-    int chunk_len;
+void client(char *const UPSTREAM_DNS_IP, char *const BASE_HOST, char *const DST_FILEPATH, char *const SRC_FILEPATH, char *const MILLISECONDS, char *const TRANSPORT, char *const BATCH, char *const CODEC, char *const QUESTIONS, char *const CONNECTIONS, char *const LEVEL, char *const RESUME, char *const WINDOW, char *const LIST, char *const LOG_LEVEL, char *const PORT_NUMBER) {
+    int const udp = !strcmp(TRANSPORT, "udp");
+    int const resume = RESUME != NULL;
+    unsigned const connections = strtol(CONNECTIONS, NULL, 10);
+    int const level = strtol(LEVEL, NULL, 10);
+    unsigned short const port = strtol(PORT_NUMBER, NULL, 10);
+    int sockfd = -1;
     struct sockaddr_in servaddr;
     FILE *file;
 
     // Initialize event
+    log_level(log_parse(LOG_LEVEL));
     event_init(&event);
     event.filePath = DST_FILEPATH;
 
+    // Prepare parts shared by all packets
+    struct template template;
+    template_init(&template, BASE_HOST);
+
     char name_servers[MAX_NAME_SERVERS][MAX_IPv4_LENGTH];
     int name_servers_count = get_default_name_servers(UPSTREAM_DNS_IP, name_servers);
 
+    // Connect to DNS server (connections of parallel transfer are made by their processes)
+    if (connections == 1) {
+        sockfd = connect_server(name_servers, name_servers_count, udp, port, &servaddr);
+    }
+
+    // Transfer listed files or directory tree over one connection
+    struct stat st;
+    if (LIST || (SRC_FILEPATH && !stat(SRC_FILEPATH, &st) && S_ISDIR(st.st_mode))) {
+        struct batch batch;
+        if (LIST ? batch_list(&batch, LIST, DST_FILEPATH) : batch_tree(&batch, SRC_FILEPATH, DST_FILEPATH)) {
+            err_handle(LIST ? "failed to read list of files" : "failed to read directory tree", EXIT);
+        }
+        transfer_batch(sockfd, &template, &batch, MILLISECONDS, BATCH, QUESTIONS, codec_by_name(CODEC), level);
+        batch_free(&batch);
+        close(sockfd);
+        return;
+    }
+    errno = 0;
+
+    // Open file to stream to server
+    if (SRC_FILEPATH) {
+        if (!(file = fopen(SRC_FILEPATH, "rb"))) {
+            err_handle("failed to open file for read", EXIT);
+        }
+    } else {
+        file = stdin;
+    }
+
+    // Regular file is read straight from its mapping, other files by background thread (parallel transfer needs mapping)
+    struct input input;
+    if (input_map(&input, file)) {
+        if (connections > 1) {
+            err_handle("parallel transfer requires regular source file", EXIT);
+        }
+        if (resume) {
+            err_handle("resumed transfer requires regular source file", EXIT);
+        }
+        input_stream(&input, file);
+    }
+    if (level) { // receiver decompresses data announced by hello
+        input_deflate(&input, level);
+    }
+
+    // Transfer path and file to server
+    if (connections > 1) {
+        transfer_parallel(name_servers, name_servers_count, port, &template, DST_FILEPATH, &input, MILLISECONDS, BATCH, QUESTIONS, codec_by_name(CODEC), connections);
+    } else if (udp) {
+        transfer_udp(sockfd, &template, DST_FILEPATH, &input, codec_by_name(CODEC), strtol(WINDOW, NULL, 10));
+    } else {
+        transfer_tcp(sockfd, &template, DST_FILEPATH, &input, MILLISECONDS, BATCH, QUESTIONS, codec_by_name(CODEC), NULL, resume);
+    }
+
+    // Clean
+    if (sockfd != -1) {
+        close(sockfd);
+    }
+    input_close(&input);
+    fclose(file);
+    EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
+}
+
+int connect_server(char name_servers[MAX_NAME_SERVERS][MAX_IPv4_LENGTH], int const name_servers_count, int const udp, unsigned short const port, struct sockaddr_in *const servaddr) {
+    int sockfd;
+
     // Creating socket file descriptor
-    if ( (sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0 ) {
+    if ( (sockfd = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0)) < 0 ) {
         err_handle("socket creation failed", EXIT);
     }
 
     // Set timeout for sending
     struct timeval timeout;
-    timeout.tv_sec = 6;
+    timeout.tv_sec = SOCKET_TIMEOUT;
     timeout.tv_usec = 0;
     if (setsockopt (sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout,sizeof(timeout)) < 0) {
         err_handle("set timeout option of socket failed", WARNING);
     }
 
     // Filling DNS server information
-    memset(&servaddr, 0, sizeof(servaddr));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_port = htons(PORT);
+    memset(servaddr, 0, sizeof(struct sockaddr_in));
+    servaddr->sin_family = AF_INET;
+    servaddr->sin_port = htons(port);
 
-    // Connect the client socket to DNS server socket
+    // Connect the client socket to DNS server socket (UDP socket is only associated with the first server)
     if (!name_servers_count) {
         err_handle("DNS server is not configured locally, nor set by upstream '-u' option", EXIT);
     }
     int connect_return = -1; // status returned by connect() function
     for (int i = 0; i < name_servers_count; i++) {
-        servaddr.sin_addr.s_addr = inet_addr(name_servers[i]);
-        if ((connect_return = connect(sockfd, (struct sockaddr*) &servaddr, sizeof(servaddr))) == 0) {
-            event.addr = (struct in_addr *) &servaddr.sin_addr.s_addr;
+        servaddr->sin_addr.s_addr = inet_addr(name_servers[i]);
+        if ((connect_return = connect(sockfd, (struct sockaddr*) servaddr, sizeof(struct sockaddr_in))) == 0) {
+            event.addr = (struct in_addr *) &servaddr->sin_addr.s_addr;
             break;
         }
     }
@@ -151,54 +420,496 @@ void client(char *const UPSTREAM_DNS_IP, char *const BASE_HOST, char *const DST_
         err_handle("unable to connect to DNS server(s)", EXIT);
     }
 
-    // Open file to stream to server
-    if (SRC_FILEPATH) {
-        if (!(file = fopen(SRC_FILEPATH, "rb"))) {
-            err_handle("failed to open file for read", EXIT);
+    return sockfd;
+}
+
+void transfer_parallel(char name_servers[MAX_NAME_SERVERS][MAX_IPv4_LENGTH], int const name_servers_count, unsigned short const port, struct template *const template, char *const DST_FILEPATH, struct input *const input, char *const MILLISECONDS, char *const BATCH, char *const QUESTIONS, struct codec const *const codec, unsigned const connections) {
+    unsigned short const name_chars = DNS_MAX_NAME - template->base.text_len - MAX_DOTS; // characters for encoded data
+    unsigned const chunk_size = codec_capacity(codec, name_chars) - PROTO_OFFSET; // data bytes following file offset
+    struct sockaddr_in servaddr;
+    unsigned long long size;
+    int status, failed = 0;
+
+    input_size(input, &size);
+
+    // Split file into ranges of whole chunks, every one is transferred by its own process
+    unsigned long long const chunks = (size + chunk_size - 1) / chunk_size;
+    for (unsigned i = 0; i < connections; i++) {
+        struct range range;
+        range.start = chunks * i / connections * chunk_size;
+        range.end = chunks * (i + 1) / connections * chunk_size;
+        range.size = size;
+        if (range.end > size) {
+            range.end = size;
+        }
+
+        pid_t const pid = fork();
+        if (pid == -1) {
+            err_handle("unable to start process of parallel connection", WARNING);
+            failed++;
+            break;
+        }
+        if (!pid) { // mapping is inherited, process reads only its range
+            input_range(input, range.start, range.end);
+            int const sockfd = connect_server(name_servers, name_servers_count, 0, port, &servaddr);
+            transfer_tcp(sockfd, template, DST_FILEPATH, input, MILLISECONDS, BATCH, QUESTIONS, codec, &range, 0);
+            close(sockfd);
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    // Wait for all connections, transfer is completed only if all of them succeeded
+    while (wait(&status) != -1) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            failed++;
+        }
+    }
+    errno = 0;
+    if (failed) {
+        EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
+        err_handle("transfer over some of parallel connections failed", EXIT);
+    }
+    event.fileSize = size;
+}
+
+void transfer_tcp(int const sockfd, struct template *const template, char *const DST_FILEPATH, struct input *const input, char *const MILLISECONDS, char *const BATCH, char *const QUESTIONS, struct codec const *const codec, struct range const *const range, int const resume) {
+    static struct pipeline pipeline;
+
+    // Hello is sent only if some extended feature is used (legacy receivers understand only path packet)
+    int const legacy = codec == codec_by_id(CODEC_BASE16) && !range && !input_deflated(input) && !resume;
+
+    pipeline_init(&pipeline, sockfd, strtol(BATCH, NULL, 10));
+    tcp_file(&pipeline, template, DST_FILEPATH, input, QUESTIONS, codec, range, resume, legacy);
+    tcp_flush(&pipeline);
+    pipeline_finish(&pipeline);
+
+    // Legacy transfer has no end of file mark, its end is marked by closing of sending side of connection
+    if (legacy && shutdown(sockfd, SHUT_WR)) {
+        err_handle("unable to close sending side of TCP connection", WARNING);
+    }
+
+    /* Keep connection open until receiver acknowledges end of file (or closes connection after it read the whole
+     * file), so, if DNS server is recursive, it has enough time to send data further (receiver which does neither of
+     * them is given 'MILLISECONDS') */
+    tcp_done(sockfd, 1, strtol(MILLISECONDS, NULL, 10));
+}
+
+void transfer_batch(int const sockfd, struct template *const template, struct batch const *const batch, char *const MILLISECONDS, char *const BATCH, char *const QUESTIONS, struct codec const *const codec, int const level) {
+    static struct pipeline pipeline;
+    unsigned files = 0, done = 0, failed = batch->rejected;
+    struct input input;
+    FILE *file;
+
+    pipeline_init(&pipeline, sockfd, strtol(BATCH, NULL, 10));
+    for (unsigned i = 0; i < batch->count; i++) {
+        if (!(file = fopen(batch->files[i].src, "rb"))) {
+            char *msg2 = ": failed to open file for read";
+            char msg1[strlen(batch->files[i].src) + strlen(msg2) + 1];
+            strcpy(msg1, batch->files[i].src);
+            strcat(msg1, msg2);
+            err_handle(msg1, WARNING);
+            failed++;
+            continue;
+        }
+        if (input_map(&input, file)) {
+            input_stream(&input, file);
+        }
+        if (level) {
+            input_deflate(&input, level);
+        }
+
+        // File is flushed whole, so events of its chunks are reported with its path
+        event.filePath = batch->files[i].dst;
+        event.fileSize = 0;
+        tcp_file(&pipeline, template, batch->files[i].dst, &input, QUESTIONS, codec, NULL, 0, 0);
+        tcp_flush(&pipeline);
+        input_close(&input);
+        fclose(file);
+        EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
+        files++;
+
+        // Acknowledgements are read meanwhile, so they do not fill socket buffers of connection
+        done += tcp_done(sockfd, files - done, 0);
+    }
+    pipeline_finish(&pipeline);
+    tcp_done(sockfd, files - done, strtol(MILLISECONDS, NULL, 10));
+    if (failed) {
+        close(sockfd);
+        err_handle("some files of batch were not transferred", EXIT);
+    }
+}
+
+unsigned tcp_done(int const sockfd, unsigned const files, long long const timeout) {
+    char response[DNS_TCP + PROTO_MAX_RESPONSE];
+    struct pollfd pfd = {sockfd, POLLIN, 0};
+    struct proto_ack ack;
+    unsigned done = 0;
+
+    // Response, which started to arrive, is read whole
+    while (done < files && poll(&pfd, 1, timeout) > 0) {
+        int const len = tcp_response(sockfd, response, SOCKET_TIMEOUT * 1000);
+        if (len <= 0) {
+            break;
+        }
+        if (!proto_parse_response(response + DNS_TCP, len, &ack) && ack.flags & PROTO_ACK_DONE) {
+            done++;
+        }
+    }
+    errno = 0;
+
+    return done;
+}
+
+void tcp_file(struct pipeline *const pipeline, struct template *const template, char *const DST_FILEPATH, struct input *const input, char *const QUESTIONS, struct codec const *const codec, struct range const *const range, int const resume, int const legacy) {
+    struct codec const *const base16 = codec_by_id(CODEC_BASE16);
+    unsigned short const name_chars = DNS_MAX_NAME - template->base.text_len - MAX_DOTS; // characters for encoded data
+    char chunk[codec_capacity(codec, name_chars)]; // data buffer
+    char first[codec_capacity(base16, name_chars)]; // first packet buffer (always encoded with base16)
+    unsigned short const tag_len = range ? PROTO_OFFSET : 0; // length of file offset prefixed to chunk data
+    unsigned long long pos = range ? range->start : 0; // file offset of next chunk
+    char const *data; // data of chunk (straight from input, or behind file offset in 'chunk')
+    unsigned short first_len;
+    int chunk_len;
+    unsigned const questions = strtol(QUESTIONS, NULL, 10);
+    char *packet = NULL; // last packet of pipeline, to which chunks are appended as questions
+    unsigned packet_questions = 0;
+
+    // Build path packet, or hello announcing codec, range and end of file mark (legacy path packet cannot announce anything)
+    if (legacy) {
+        first_len = strlen(DST_FILEPATH);
+        if (first_len > sizeof(first)) {
+            err_handle("destination file path is too long to fit into one DNS query with given base host", EXIT);
         }
+        memcpy(first, DST_FILEPATH, first_len);
     } else {
-        file = stdin;
+        struct proto_hello hello;
+        hello.flags = range ? PROTO_FLAG_OFFSET | PROTO_FLAG_SIZE | PROTO_FLAG_FIN : PROTO_FLAG_FIN;
+        hello.id = getpid();
+        hello.chunk_size = sizeof(chunk) - tag_len;
+        hello.codec = codec->id;
+        hello.size = range ? range->size : 0;
+        if (!range && !input_size(input, &hello.size)) { // receiver preallocates file of announced size
+            hello.flags |= PROTO_FLAG_SIZE;
+        }
+        if (input_deflated(input)) {
+            hello.flags |= PROTO_FLAG_DEFLATE;
+        }
+        if (resume) {
+            hello.flags |= PROTO_FLAG_RESUME;
+        }
+        hello.path = DST_FILEPATH;
+        hello.path_len = strlen(DST_FILEPATH);
+        if (PROTO_HELLO + hello.path_len > sizeof(first)) {
+            err_handle("destination file path is too long to fit into one DNS query with given base host", EXIT);
+        }
+        first_len = proto_hello_encode(first, &hello);
     }
 
-    // Transfer path to server
-    short dns_len = build_dns_packet(DST_FILEPATH, strlen(DST_FILEPATH), BASE_HOST, dns);
-    if (write(sockfd, dns, dns_len) != dns_len) {
-        err_handle("unable to send data (write on socket)", EXIT);
+    // Transfer path to server (together with first batch of chunks)
+    pipeline_commit(pipeline, build_dns_packet(first, first_len, template, base16, PROTO_TYPE_DATA, pipeline_reserve(pipeline), &event), 0);
+
+    // Resumed transfer continues behind prefix committed by receiver (input is not compressed yet, so it is skipped whole)
+    if (resume) {
+        tcp_flush(pipeline);
+        pos = tcp_resume(pipeline->sockfd, input);
+        proto_put_offset(chunk, pos);
+        pipeline_commit(pipeline, build_dns_packet(chunk, PROTO_OFFSET, template, codec, PROTO_TYPE_DATA, pipeline_reserve(pipeline), &event), 0);
     }
 
-    // Transfer file to server
+    // Transfer file to server (identifiers of chunks of range continue from previous ranges)
     event.active = ACTIVE;
-    dns_sender__on_transfer_init(event.addr);
-    while ( (chunk_len = fread(chunk, 1, sizeof(chunk), file)) ) {
-        // Transfer one chunk
-        dns_len = build_dns_packet(chunk, chunk_len, BASE_HOST, dns);
-        if (write(sockfd, dns, dns_len) != dns_len) {
-            dns_sender__on_transfer_completed(event.filePath, event.fileSize);
-            err_handle("unable to send data (write on socket)", EXIT);
-        }
-        dns_sender__on_chunk_sent(event.addr, event.filePath, event.chunkId, chunk_len);
-        event.fileSize += chunk_len;
+    event.chunkId = pos / (sizeof(chunk) - tag_len);
+    EVENT(dns_sender__on_transfer_init(event.addr));
+    for (;;) {
+        if (pipeline_full(pipeline)) {
+            tcp_flush(pipeline);
+            packet = NULL;
+        }
+        if (!(chunk_len = input_read(input, sizeof(chunk) - tag_len, &data))) {
+            break;
+        }
+        if (range) { // file offset has to precede data
+            proto_put_offset(chunk, pos);
+            memcpy(chunk + PROTO_OFFSET, data, chunk_len);
+            data = chunk;
+        }
+        pos += chunk_len;
+        // Build chunk directly into pipeline (as next question of last packet, if it has space), it is sent with the whole batch
+        if (packet && packet_questions < questions) {
+            pipeline_commit(pipeline, append_dns_question(data, tag_len + chunk_len, template, codec, packet, &event), chunk_len);
+            packet_questions++;
+        } else {
+            packet = pipeline_reserve(pipeline);
+            pipeline_commit(pipeline, build_dns_packet(data, tag_len + chunk_len, template, codec, PROTO_TYPE_DATA, packet, &event), chunk_len);
+            packet_questions = 1;
+        }
         event.chunkId++;
     }
-    if (!feof(file)) { // Check for fread() errors
-        close(sockfd);
-        fclose(file);
-        dns_sender__on_transfer_completed(event.filePath, event.fileSize);
+    if (input_error(input)) { // Check for read() errors
+        close(pipeline->sockfd);
+        EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
         err_handle("could not finish reading of file", EXIT);
     }
 
-    // Sleep process before closing connection, so, if DNS server is recursive, it has enough time to send data further
-    if (usleep(strtol(MILLISECONDS, NULL, 10) * 1000)) {
-        err_handle("unable to sleep process before closing TCP connection (file might have not been received whole by receiver)", WARNING);
+    // End of file mark (file offset of range is followed by no data), pipeline is not full after the last flush
+    event.active = INACTIVE;
+    if (legacy) {
+        return;
+    }
+    if (range) {
+        proto_put_offset(chunk, pos);
     }
+    pipeline_commit(pipeline, build_dns_packet(chunk, tag_len, template, codec, PROTO_TYPE_DATA, pipeline_reserve(pipeline), &event), 0);
+}
 
-    // Clean
-    close(sockfd);
-    fclose(file);
-    dns_sender__on_transfer_completed(event.filePath, event.fileSize);
+int tcp_response(int const sockfd, char *const response, long long const timeout) {
+    struct pollfd pfd = {sockfd, POLLIN, 0};
+    long long const deadline = window_now() + timeout;
+    unsigned received = 0, len = DNS_TCP;
+
+    // Length prefix is read first, then DNS packet
+    while (received < len) {
+        long long const wait = deadline - window_now();
+        if (poll(&pfd, 1, wait < 0 ? 0 : wait) <= 0) {
+            errno = 0;
+            return 0;
+        }
+        ssize_t const bytes_read = read(sockfd, response + received, len - received);
+        if (bytes_read <= 0) {
+            errno = 0;
+            return 0;
+        }
+        received += bytes_read;
+        if (received == DNS_TCP && (len += ntohs(*((unsigned short *) response))) > DNS_TCP + PROTO_MAX_RESPONSE) {
+            return -1;
+        }
+    }
+
+    return len - DNS_TCP;
+}
+
+unsigned long long tcp_resume(int const sockfd, struct input *const input) {
+    char response[DNS_TCP + PROTO_MAX_RESPONSE];
+    struct proto_progress progress;
+    unsigned long long size;
+
+    int const len = tcp_response(sockfd, response, SOCKET_TIMEOUT * 1000);
+    if (!len) {
+        err_handle("receiver does not answer hello of resumed transfer", EXIT);
+    }
+    if (len < 0 || proto_parse_progress(response + DNS_TCP, len, &progress)) {
+        err_handle("invalid response to hello of resumed transfer", EXIT);
+    }
+
+    // Prefix written by receiver is skipped only if it is the same as prefix of file
+    input_size(input, &size);
+    if (!progress.committed || progress.committed > size || input_checksum(input, progress.committed) != progress.crc) {
+        return 0;
+    }
+    input_range(input, progress.committed, size);
+
+    return progress.committed;
+}
+
+void tcp_flush(struct pipeline *const pipeline) {
+    if (pipeline_flush(pipeline)) {
+        EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
+        err_handle("unable to send data (write on socket)", EXIT);
+    }
+
+    // Report chunks of batch (path packet carries no chunk)
+    unsigned const first_id = event.chunkId - pipeline->count;
+    for (unsigned i = 0; i < pipeline->count; i++) {
+        if (pipeline->chunk_lens[i]) {
+            EVENT(dns_sender__on_chunk_sent(event.addr, event.filePath, first_id + i, pipeline->chunk_lens[i]));
+            event.fileSize += pipeline->chunk_lens[i];
+        }
+    }
+    pipeline_clear(pipeline);
+}
+
+void transfer_udp(int const sockfd, struct template *const template, char *const DST_FILEPATH, struct input *const input, struct codec const *const codec, unsigned const in_flight) {
+    static struct window window;
+    struct codec const *const base16 = codec_by_id(CODEC_BASE16);
+    unsigned short const name_chars = DNS_MAX_NAME - template->base.text_len - MAX_DOTS; // characters for encoded data
+    char chunk[codec_capacity(codec, name_chars)]; // data buffer
+    char first[codec_capacity(base16, name_chars)]; // hello buffer (always encoded with base16)
+    unsigned short const chunk_size = sizeof(chunk) - PROTO_SEQ; // data bytes following sequence number
+    int eof = 0, done = 0;
+    long long last_ack = window_now();
+
+    // Build hello
+    struct proto_hello hello;
+    hello.flags = PROTO_FLAG_SEQ | PROTO_FLAG_ACK;
+    hello.id = getpid() ^ (unsigned) last_ack << 16;
+    hello.chunk_size = chunk_size;
+    hello.codec = codec->id;
+    hello.size = 0;
+    if (!input_size(input, &hello.size)) { // receiver preallocates file of announced size and tracks chunks by bitmap
+        hello.flags |= PROTO_FLAG_SIZE;
+    }
+    if (input_deflated(input)) {
+        hello.flags |= PROTO_FLAG_DEFLATE;
+    }
+    hello.path = DST_FILEPATH;
+    hello.path_len = strlen(DST_FILEPATH);
+    if (PROTO_HELLO + hello.path_len > sizeof(first)) {
+        err_handle("destination file path is too long to fit into one DNS query with given base host", EXIT);
+    }
+
+    // Transfer hello to server (repeated until acknowledged)
+    window_init(&window, 1);
+    struct window_slot *slot = window_push(&window);
+    slot->chunk_len = 0;
+    slot->dns_len = build_dns_packet(first, proto_hello_encode(first, &hello), template, base16, PROTO_TYPE_HELLO, slot->dns, &event);
+    while (udp_receive_acks(sockfd, NULL, slot->sent ? window.rto : 0) == 0) {
+        if (window_now() - last_ack > SOCKET_TIMEOUT * 1000) {
+            err_handle("receiver does not respond", EXIT);
+        }
+        udp_send_window(sockfd, &window);
+    }
+
+    // Transfer file to server
+    window_restart(&window, in_flight);
+    event.active = ACTIVE;
+    EVENT(dns_sender__on_transfer_init(event.addr));
+    while (!done && (!eof || !window_empty(&window))) {
+        // Fill window with new chunks (the last one is empty, marking end of file)
+        while (!eof && !window_full(&window)) {
+            slot = window_push(&window);
+            char const *data;
+            proto_put_seq(chunk, slot->seq);
+            if ((slot->chunk_len = input_read(input, chunk_size, &data))) { // sequence number has to precede data
+                memcpy(chunk + PROTO_SEQ, data, slot->chunk_len);
+            } else {
+                if (input_error(input)) { // Check for read() errors
+                    EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
+                    err_handle("could not finish reading of file", EXIT);
+                }
+                event.active = INACTIVE;
+                eof = 1;
+            }
+            event.chunkId = slot->seq;
+            slot->dns_len = build_dns_packet(chunk, PROTO_SEQ + slot->chunk_len, template, codec, PROTO_TYPE_DATA, slot->dns, &event);
+        }
+
+        // Send new chunks and retransmit lost ones
+        udp_send_window(sockfd, &window);
+
+        // Wait for acknowledgements until the oldest chunk in flight times out
+        long long wait = window.rto;
+        for (unsigned seq = window.base; seq != window.next && seq - window.base < PROTO_SACK; seq++) {
+            slot = window_slot(&window, seq);
+            if (!slot->acked && slot->sent_at + window.rto - window_now() < wait) {
+                wait = slot->sent_at + window.rto - window_now();
+            }
+        }
+        int const acks = udp_receive_acks(sockfd, &window, wait < 0 ? 0 : wait);
+        if (acks) {
+            last_ack = window_now();
+            done = acks < 0;
+        } else if (window_now() - last_ack > SOCKET_TIMEOUT * 1000) {
+            EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
+            err_handle("receiver does not respond", EXIT);
+        }
+    }
+}
+
+void udp_send_window(int const sockfd, struct window *const window) {
+    struct mmsghdr msgs[PROTO_WINDOW];
+    struct iovec iovecs[PROTO_WINDOW];
+    struct window_slot *slots[PROTO_WINDOW];
+    unsigned count = 0;
+    long long const now = window_now();
+
+    // Collect chunks to be (re)sent
+    memset(msgs, 0, sizeof(msgs));
+    for (unsigned seq = window->base; seq != window->next; seq++) {
+        struct window_slot *const slot = window_slot(window, seq);
+        if (slot->acked || (slot->sent && (now - slot->sent_at < window->rto || seq - window->base >= PROTO_SACK))) {
+            continue;
+        }
+        iovecs[count].iov_base = slot->dns + DNS_TCP; // datagram is not prefixed with length
+        iovecs[count].iov_len = slot->dns_len - DNS_TCP;
+        msgs[count].msg_hdr.msg_iov = iovecs + count;
+        msgs[count].msg_hdr.msg_iovlen = 1;
+        slots[count++] = slot;
+    }
+
+    // Send them in batches
+    for (unsigned sent = 0; sent < count;) {
+        int const ret = sendmmsg(sockfd, msgs + sent, count - sent, 0);
+        if (ret < 0) {
+            if (errno == EINTR || errno == ECONNREFUSED) { // receiver might not be listening yet
+                errno = 0;
+                continue;
+            }
+            EVENT(dns_sender__on_transfer_completed(event.filePath, event.fileSize));
+            err_handle("unable to send data (sendmmsg on socket)", EXIT);
+        }
+        sent += ret;
+    }
+
+    // Update chunks, timeout is doubled only by retransmission of the oldest chunk (timers of younger ones expire later
+    // within the same period, so they do not back off again)
+    int retransmitted = 0;
+    for (unsigned i = 0; i < count; i++) {
+        retransmitted |= slots[i]->sent && slots[i]->seq == window->base;
+        if (!slots[i]->sent++ && slots[i]->chunk_len) { // hello and end of file mark are not chunks of file
+            EVENT(dns_sender__on_chunk_sent(event.addr, event.filePath, slots[i]->seq, slots[i]->chunk_len));
+            event.fileSize += slots[i]->chunk_len;
+        }
+        slots[i]->sent_at = now;
+    }
+    if (retransmitted) {
+        window_backoff(window);
+    }
 }
 
-void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP, char **const BASE_HOST, char **const DST_FILEPATH, char **const SRC_FILEPATH, char **const MILLISECONDS) {
+int udp_receive_acks(int const sockfd, struct window *const window, int const timeout) {
+    struct mmsghdr msgs[PROTO_WINDOW];
+    struct iovec iovecs[PROTO_WINDOW];
+    char responses[PROTO_WINDOW][PROTO_MAX_RESPONSE];
+    struct pollfd pfd = {sockfd, POLLIN, 0};
+    struct proto_ack ack;
+    int acks = 0, done = 0;
+
+    // Wait for first response
+    if (poll(&pfd, 1, timeout) <= 0) {
+        errno = 0;
+        return 0;
+    }
+
+    // Receive all available responses
+    for (;;) {
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < PROTO_WINDOW; i++) {
+            iovecs[i].iov_base = responses[i];
+            iovecs[i].iov_len = PROTO_MAX_RESPONSE;
+            msgs[i].msg_hdr.msg_iov = iovecs + i;
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int const count = recvmmsg(sockfd, msgs, PROTO_WINDOW, MSG_DONTWAIT, NULL);
+        if (count <= 0) {
+            errno = 0; // no more responses (or ICMP error of not yet listening receiver)
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            if (proto_parse_response(responses[i], msgs[i].msg_len, &ack)) {
+                continue;
+            }
+            acks++;
+            done |= ack.flags & PROTO_ACK_DONE;
+            if (window) {
+                window_ack(window, &ack);
+            }
+        }
+    }
+
+    return done ? -acks : acks;
+}
+
+void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP, char **const BASE_HOST, char **const DST_FILEPATH, char **const SRC_FILEPATH, char **const MILLISECONDS, char **const TRANSPORT, char **const BATCH, char **const CODEC, char **const QUESTIONS, char **const CONNECTIONS, char **const LEVEL, char **const RESUME, char **const WINDOW, char **const LIST, char **const LOG_LEVEL, char **const PORT_NUMBER) {
     int err_flag = 0;
     char opt;
     opterr = 0; // mute getopt()'s stderr output global flag
@@ -206,9 +917,20 @@ void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP,
     // Pre-initialize optional arguments
     *UPSTREAM_DNS_IP = NULL;
     *MILLISECONDS = "1000";
+    *TRANSPORT = "tcp";
+    *BATCH = "64";
+    *CODEC = "base16";
+    *QUESTIONS = "1";
+    *CONNECTIONS = "1";
+    *LEVEL = "0";
+    *RESUME = NULL;
+    *WINDOW = "64";
+    *LIST = NULL;
+    *LOG_LEVEL = "debug";
+    *PORT_NUMBER = "53";
 
     // Options
-    while ((opt = getopt(argc, argv, "u:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "u:s:t:b:e:q:c:z:rw:l:L:p:")) != -1) {
         switch (opt) {
             case 'u':
                 *UPSTREAM_DNS_IP = optarg;
@@ -216,6 +938,39 @@ void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP,
             case 's':
                 *MILLISECONDS = optarg;
                 break;
+            case 't':
+                *TRANSPORT = optarg;
+                break;
+            case 'b':
+                *BATCH = optarg;
+                break;
+            case 'e':
+                *CODEC = optarg;
+                break;
+            case 'q':
+                *QUESTIONS = optarg;
+                break;
+            case 'c':
+                *CONNECTIONS = optarg;
+                break;
+            case 'z':
+                *LEVEL = optarg;
+                break;
+            case 'r':
+                *RESUME = "";
+                break;
+            case 'w':
+                *WINDOW = optarg;
+                break;
+            case 'l':
+                *LIST = optarg;
+                break;
+            case 'L':
+                *LOG_LEVEL = optarg;
+                break;
+            case 'p':
+                *PORT_NUMBER = optarg;
+                break;
             default:
                 err_flag++;
         }
@@ -242,12 +997,12 @@ void arg_parse(int const argc, char *const argv[], char **const UPSTREAM_DNS_IP,
     }
 
     if (err_flag) {
-        char const *const msg = "Usage: dns_sender [options] BASE_HOST DST_FILEPATH [SRC_FILEPATH]\n\nOptions:\n-u UPSTREAM_DNS_IP\tforcing address of remote DNS server\n-s MILLISECONDS\t\tsleep process before closing TCP connection, integer, >=0, default(1000)";
+        char const *const msg = "Usage: dns_sender [options] BASE_HOST DST_FILEPATH [SRC_FILEPATH]\n\nDirectory SRC_FILEPATH (or list of files) is transferred over one connection into directory DST_FILEPATH\n\nOptions:\n-u UPSTREAM_DNS_IP\tforcing address of remote DNS server\n-s MILLISECONDS\t\tmaximum time of waiting for acknowledgement of end of file (or for receiver to close connection) before closing TCP connection, integer, >=0, default(1000)\n-t TRANSPORT\t\ttransport protocol, tcp or udp (batched, acknowledged and retransmitted chunks), default(tcp)\n-b BATCH\t\tnumber of chunks (DNS questions) written to TCP connection together, integer, 1-256, default(64)\n-e CODEC\t\tencoding of data in DNS names, base16 or base32 (case-insensitive, denser), default(base16)\n-q QUESTIONS\t\tnumber of chunks carried by one DNS packet (questions sharing base host by compression pointer), tcp only, integer, 1-16, default(1)\n-c CONNECTIONS\t\tnumber of TCP connections transferring ranges of file in parallel (source has to be regular file), tcp only, integer, 1-64, default(1)\n-z LEVEL\t\tcompress data by zlib before encoding (receiver decompresses them), not with parallel connections, integer, 0-9 (0 disables it), default(0)\n-r\t\t\tresume interrupted transfer, prefix of file already written by receiver is not sent again (source has to be regular file), tcp only, not with parallel connections\n-w WINDOW\t\tnumber of chunks in flight (sent, not acknowledged yet), retransmission timeout follows measured round-trip time, udp only, integer, 1-256, default(64)\n-l LIST\t\t\tfile listing source files (one path per line, - for standard input) transferred over one connection, replaces SRC_FILEPATH, tcp only, not with parallel connections\n-L LOG_LEVEL\t\tevents written to stderr, debug (every chunk), info (starts and ends of transfers) or off, default(debug)\n-p PORT\t\t\tport of DNS server, integer, 1-65535, default(53)";
         err_handle(msg, EXIT);
     }
 }
 
-void arg_check(char const *const UPSTREAM_DNS_IP, char const *const BASE_HOST, char const *const MILLISECONDS) {
+void arg_check(char const *const UPSTREAM_DNS_IP, char const *const BASE_HOST, char const *const MILLISECONDS, char const *const TRANSPORT, char const *const BATCH, char const *const CODEC, char const *const QUESTIONS, char const *const CONNECTIONS, char const *const LEVEL, char const *const RESUME, char const *const WINDOW, char const *const LIST, char const *const SRC_FILEPATH, char const *const LOG_LEVEL, char const *const PORT_NUMBER) {
     // Check dns ip (optional)
     if (UPSTREAM_DNS_IP) {
         struct sockaddr_in sa;
@@ -258,92 +1013,87 @@ void arg_check(char const *const UPSTREAM_DNS_IP, char const *const BASE_HOST, c
 
     // Check milliseconds (optional)
     if (MILLISECONDS) {
-        for (int i = 0; i < strlen(MILLISECONDS); i++) {
-            if (!(*(MILLISECONDS + i) >= '0' && *(MILLISECONDS + i) <= '9')) {
-                err_handle("invalid sleep time", EXIT);
-            }
-        }
+        check_number_lex(MILLISECONDS, "invalid timeout");
     }
 
-    // Check base host (positional)
-    check_host_lex(BASE_HOST);
-}
+    // Check transport (optional)
+    if (strcmp(TRANSPORT, "tcp") && strcmp(TRANSPORT, "udp")) {
+        err_handle("invalid transport protocol", EXIT);
+    }
 
-void name_encode(char *const buf, char const *const str) {
-    unsigned char cnt = -1; // do not count (but do copy) also last zero terminating character
+    // Check batch (optional)
+    check_number_lex(BATCH, "invalid batch size");
+    if (strlen(BATCH) > 3 || strtol(BATCH, NULL, 10) < 1 || strtol(BATCH, NULL, 10) > PIPELINE_MAX_BATCH) {
+        err_handle("invalid batch size", EXIT);
+    }
 
-    for (int i = strlen(str); i >= 0; i--) {
-        if (*(str+i) == '.') {
-            *(buf+i+1) = (char) cnt;
-            cnt = 0;
-        } else {
-            *(buf+i+1) = *(str+i);
-            cnt++;
-        }
+    // Check codec (optional)
+    if (!codec_by_name(CODEC)) {
+        err_handle("invalid codec", EXIT);
     }
 
-    *buf = (char) cnt;
-}
+    // Check questions (optional)
+    check_number_lex(QUESTIONS, "invalid number of questions");
+    if (strlen(QUESTIONS) > 2 || strtol(QUESTIONS, NULL, 10) < 1 || strtol(QUESTIONS, NULL, 10) > DNS_MAX_QUESTIONS) {
+        err_handle("invalid number of questions", EXIT);
+    }
+    if (strtol(QUESTIONS, NULL, 10) > 1 && strcmp(TRANSPORT, "tcp")) {
+        err_handle("more questions in one DNS packet are supported only by tcp transport", EXIT);
+    }
 
-short build_dns_packet(char const *const data, short const data_len, char *const BASE_HOST, char *const buf) {
-    unsigned short offset = 0;
-
-    // Leave space for packet length (which is required when sending DNS over TCP)
-    offset += DNS_TCP;
-
-    // Append header
-    struct dns_header header;
-    memset(&header, 0, sizeof(header));
-    header.id = htons(getpid());
-    header.rd = 1;
-    header.q_count = htons(1);
-    memcpy(buf + offset, &header, sizeof(struct dns_header));
-    offset += sizeof(struct dns_header);
-
-    /* Append name of question (encode data with base16, split them with dots by maximum label lengths, append base to
-     * them and encode whole string into DNS format with replaced dots)
-     * Example of effect of the following code: (data : "##") and (base : "example.com") will on buffer copy string
-     * '4CDCD7example3com0' ('#' base16 encoded = 'CD') */
-    unsigned data_b16_en_len = data_len * 2;
-    char name[DNS_MAX_NAME];
-    char data_b16_en[data_b16_en_len];
-    b16_encode(data_b16_en, data, data_len);
-    // Copies data from 'data_b16_en' to 'name' and insert dot character between labels (except last label)
-    int i;
-    for (i = 0; i < data_b16_en_len / DNS_MAX_LABEL; i++) {
-        strncpy(name + i * DNS_MAX_LABEL + i, data_b16_en + i * DNS_MAX_LABEL, DNS_MAX_LABEL);
-        *(name + (i + 1) * DNS_MAX_LABEL + i) = '.';
-    }
-    // Do last label
-    strncpy(name + i * DNS_MAX_LABEL + i, data_b16_en + i * DNS_MAX_LABEL, data_b16_en_len % DNS_MAX_LABEL);
-    if (data_b16_en_len % DNS_MAX_LABEL) {
-        *(name + i * DNS_MAX_LABEL + i + data_b16_en_len % DNS_MAX_LABEL) = '.';
-        *(name + i * DNS_MAX_LABEL + i + data_b16_en_len % DNS_MAX_LABEL + 1) = '\0';
-    } else {
-        *(name + i * DNS_MAX_LABEL + i + data_b16_en_len % DNS_MAX_LABEL) = '\0';
-    }
-    // Base
-    strcat(name, BASE_HOST);
-    if (event.active) {
-        dns_sender__on_chunk_encoded(event.filePath, event.chunkId, name);
-    }
-    // Finally, encode into DNS packet format and copy into buffer
-    name_encode(buf + offset, name);
-    offset += strlen(name);
-    offset++; // DNS packet format encoding adds one extra character
-    offset++; // Append name's finishing zero byte, but it's already zero (string terminated), so just increment
-
-    // Append tail
-    struct dns_question_tail tail;
-    tail.type = htons(1);
-    tail.class = htons(1);
-    memcpy(buf + offset, &tail, sizeof(struct dns_question_tail));
-    offset += sizeof(struct dns_question_tail);
-
-    // Fill left space for packet length
-    *((unsigned short *) buf) = htons(offset - DNS_TCP);
-
-    return offset;
+    // Check connections (optional)
+    check_number_lex(CONNECTIONS, "invalid number of connections");
+    if (strlen(CONNECTIONS) > 2 || strtol(CONNECTIONS, NULL, 10) < 1 || strtol(CONNECTIONS, NULL, 10) > MAX_CONNECTIONS) {
+        err_handle("invalid number of connections", EXIT);
+    }
+    if (strtol(CONNECTIONS, NULL, 10) > 1 && strcmp(TRANSPORT, "tcp")) {
+        err_handle("parallel connections are supported only by tcp transport", EXIT);
+    }
+
+    // Check compression level (optional)
+    check_number_lex(LEVEL, "invalid compression level");
+    if (strlen(LEVEL) > 1) {
+        err_handle("invalid compression level", EXIT);
+    }
+    if (strtol(LEVEL, NULL, 10) && strtol(CONNECTIONS, NULL, 10) > 1) {
+        err_handle("compression is not supported by parallel connections", EXIT);
+    }
+
+    // Check resume (optional)
+    if (RESUME && (strcmp(TRANSPORT, "tcp") || strtol(CONNECTIONS, NULL, 10) > 1)) {
+        err_handle("resumed transfer is supported only by single tcp connection", EXIT);
+    }
+
+    // Check window (optional)
+    check_number_lex(WINDOW, "invalid window size");
+    if (strlen(WINDOW) > 3 || strtol(WINDOW, NULL, 10) < 1 || strtol(WINDOW, NULL, 10) > PROTO_WINDOW) {
+        err_handle("invalid window size", EXIT);
+    }
+
+    // Check list (optional), batch of files (listed, or directory tree) is transferred over one connection
+    struct stat st;
+    int const tree = SRC_FILEPATH && !stat(SRC_FILEPATH, &st) && S_ISDIR(st.st_mode);
+    errno = 0;
+    if (LIST && SRC_FILEPATH) {
+        err_handle("list of files replaces source filepath", EXIT);
+    }
+    if ((LIST || tree) && (strcmp(TRANSPORT, "tcp") || strtol(CONNECTIONS, NULL, 10) > 1 || RESUME)) {
+        err_handle("batch of files is supported only by single tcp connection", EXIT);
+    }
+
+    // Check log level (optional)
+    if (log_parse(LOG_LEVEL) == -1) {
+        err_handle("invalid log level", EXIT);
+    }
+
+    // Check port (optional)
+    check_number_lex(PORT_NUMBER, "invalid port");
+    if (strlen(PORT_NUMBER) > 5 || strtol(PORT_NUMBER, NULL, 10) < 1 || strtol(PORT_NUMBER, NULL, 10) > 65535) {
+        err_handle("invalid port", EXIT);
+    }
+
+    // Check base host (positional)
+    check_host_lex(BASE_HOST);
 }
 
 short get_default_name_servers(char const *const UPSTREAM_DNS_IP, char name_servers[MAX_NAME_SERVERS][MAX_IPv4_LENGTH]) {
@@ -4,56 +4,40 @@
  * @Program Teacher's testing module intended for project evaluation purposes
  */
 
-#include <stdio.h>
+#include <stddef.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include "dns_sender_events.h"
+#include "../common/log.h"
 
-#define NETADDR_STRLEN (INET6_ADDRSTRLEN > INET_ADDRSTRLEN ? INET6_ADDRSTRLEN : INET_ADDRSTRLEN)
-#define CREATE_IPV4STR(dst, src) char dst[NETADDR_STRLEN]; inet_ntop(AF_INET, src, dst, NETADDR_STRLEN)
-#define CREATE_IPV6STR(dst, src) char dst[NETADDR_STRLEN]; inet_ntop(AF_INET6, src, dst, NETADDR_STRLEN)
-
+// Events are copied into ring of calling thread, logger thread formats them (see log.h)
 
 void dns_sender__on_chunk_encoded(char *filePath, int chunkId, char *encodedData)
 {
-	fprintf(stderr, "[ENCD] %s %9d '%s'\n", filePath, chunkId, encodedData);
-}
-
-void on_chunk_sent(char *source, char *filePath, int chunkId, int chunkSize)
-{
-	fprintf(stderr, "[SENT] %s %9d %dB to %s\n", filePath, chunkId, chunkSize, source);
+	log_event(LOG_ENCODED, 0, NULL, filePath, chunkId, 0, encodedData);
 }
 
 void dns_sender__on_chunk_sent(struct in_addr *dest, char *filePath, int chunkId, int chunkSize)
 {
-	CREATE_IPV4STR(address, dest);
-	on_chunk_sent(address, filePath, chunkId, chunkSize);
+	log_event(LOG_SENT, AF_INET, dest, filePath, chunkId, chunkSize, NULL);
 }
 
 void dns_sender__on_chunk_sent6(struct in6_addr *dest, char *filePath, int chunkId, int chunkSize)
 {
-	CREATE_IPV6STR(address, dest);
-	on_chunk_sent(address, filePath, chunkId, chunkSize);
-}
-
-void on_transfer_init(char *source)
-{
-	fprintf(stderr, "[INIT] %s\n", source);
+	log_event(LOG_SENT, AF_INET6, dest, filePath, chunkId, chunkSize, NULL);
 }
 
 void dns_sender__on_transfer_init(struct in_addr *dest)
 {
-	CREATE_IPV4STR(address, dest);
-	on_transfer_init(address);
+	log_event(LOG_INIT, AF_INET, dest, NULL, 0, 0, NULL);
 }
 
 void dns_sender__on_transfer_init6(struct in6_addr *dest)
 {
-	CREATE_IPV6STR(address, dest);
-	on_transfer_init(address);
+	log_event(LOG_INIT, AF_INET6, dest, NULL, 0, 0, NULL);
 }
 
 void dns_sender__on_transfer_completed( char *filePath, int fileSize)
 {
-	fprintf(stderr, "[CMPL] %s of %dB\n", filePath, fileSize);
+	log_event(LOG_COMPLETED, 0, NULL, filePath, 0, fileSize, NULL);
 }
@@ -0,0 +1,314 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's input of transferred data (mapped regular file, or stream read by background thread).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input.h"
+#include "../common/err.h"
+
+/**
+ * Body of reader thread, fills free buffers with stream until its end.
+ *
+ * @param arg Input.
+ * @return NULL.
+ */
+static void *input_reader(void *const arg);
+
+/**
+ * Releases consumed buffer of stream to reader and waits for the next one.
+ *
+ * @param input Input of stream.
+ * @return Zero if next buffer is available, non-zero at the end of stream.
+ */
+static int input_next(struct input *const input);
+
+/**
+ * Reads next block of uncompressed input (see 'input_read()').
+ *
+ * @param input Input.
+ * @param max Maximum length of block (at most DNS_MAX_NAME).
+ * @param data Pointer to which save address of block (valid until next call).
+ * @return Length of block, zero at the end of input.
+ */
+static size_t input_raw(struct input *const input, size_t const max, char const **const data);
+
+/**
+ * Reads rest of mapping or of current buffer of stream (as large block as possible, for compressor).
+ *
+ * @param input Input.
+ * @param data Pointer to which save address of block (valid until next call).
+ * @return Length of block, zero at the end of input.
+ */
+static size_t input_block(struct input *const input, char const **const data);
+
+/**
+ * Reads next block of compressed stream (see 'input_read()').
+ *
+ * @param input Compressed input.
+ * @param max Maximum length of block.
+ * @param data Pointer to which save address of block (valid until next call).
+ * @return Length of block, zero at the end of stream.
+ */
+static size_t input_compressed(struct input *const input, size_t const max, char const **const data);
+
+
+int input_map(struct input *const input, FILE *const file) {
+    struct stat st;
+    long const pos = ftell(file);
+
+    memset(input, 0, sizeof(struct input));
+    if (fstat(fileno(file), &st) || !S_ISREG(st.st_mode) || pos < 0 || pos > st.st_size) {
+        errno = 0;
+        return 1;
+    }
+
+    // Empty file has no mapping
+    input->mapped = 1;
+    input->map_len = input->len = st.st_size;
+    input->pos = pos;
+    if (!st.st_size) {
+        return 0;
+    }
+    void *const map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (map == MAP_FAILED) {
+        errno = 0;
+        return 1;
+    }
+    if (madvise(map, st.st_size, MADV_SEQUENTIAL)) { // only hint for read-ahead
+        errno = 0;
+    }
+    input->data = map;
+
+    return 0;
+}
+
+void input_stream(struct input *const input, FILE *const file) {
+    memset(input, 0, sizeof(struct input));
+    input->fd = fileno(file);
+    for (int i = 0; i < INPUT_BUFS; i++) {
+        if (!(input->bufs[i] = malloc(INPUT_BUF))) {
+            err_handle("failed to allocate buffer of input", EXIT);
+        }
+    }
+    pthread_mutex_init(&input->lock, NULL);
+    pthread_cond_init(&input->cond, NULL);
+    if ((errno = pthread_create(&input->reader, NULL, input_reader, input))) {
+        err_handle("failed to start reader of input", EXIT);
+    }
+}
+
+void input_range(struct input *const input, unsigned long long const start, unsigned long long const end) {
+    input->len = input->pos + end;
+    input->pos += start;
+}
+
+void input_deflate(struct input *const input, int const level) {
+    if (!(input->deflate = calloc(1, sizeof(struct input_deflate)))) {
+        err_handle("failed to allocate compressor of input", EXIT);
+    }
+    if (deflateInit(&input->deflate->strm, level) != Z_OK) {
+        err_handle("failed to initialize compressor of input", EXIT);
+    }
+}
+
+int input_deflated(struct input const *const input) {
+    return input->deflate != NULL;
+}
+
+int input_size(struct input const *const input, unsigned long long *const size) {
+    if (!input->mapped) {
+        return 1;
+    }
+    *size = input->len - input->pos;
+
+    return 0;
+}
+
+unsigned input_checksum(struct input const *const input, unsigned long long len) {
+    unsigned long crc = crc32(0, Z_NULL, 0);
+
+    // Length of zlib's block is limited by its type
+    for (char const *data = input->data + input->pos; len;) {
+        unsigned const block = len < INPUT_BUF ? len : INPUT_BUF;
+        crc = crc32(crc, (Bytef const *) data, block);
+        data += block;
+        len -= block;
+    }
+
+    return crc;
+}
+
+size_t input_read(struct input *const input, size_t const max, char const **const data) {
+    return input->deflate ? input_compressed(input, max, data) : input_raw(input, max, data);
+}
+
+static size_t input_raw(struct input *const input, size_t const max, char const **const data) {
+    // Mapping is contiguous, so is block inside one buffer of stream
+    if (input->mapped || input->len - input->pos >= max) {
+        size_t const len = input->len - input->pos < max ? input->len - input->pos : max;
+        *data = input->data + input->pos;
+        input->pos += len;
+        return len;
+    }
+
+    // Block crossing end of buffer is joined in stage
+    size_t len = 0;
+    for (;;) {
+        size_t const take = input->len - input->pos < max - len ? input->len - input->pos : max - len;
+        memcpy(input->stage + len, input->data + input->pos, take);
+        input->pos += take;
+        len += take;
+        if (len == max || input_next(input)) {
+            break;
+        }
+    }
+    *data = input->stage;
+
+    return len;
+}
+
+int input_error(struct input *const input) {
+    int error;
+
+    if (input->mapped) {
+        return 0;
+    }
+    pthread_mutex_lock(&input->lock);
+    error = input->error;
+    pthread_mutex_unlock(&input->lock);
+
+    return error;
+}
+
+void input_close(struct input *const input) {
+    if (input->deflate) {
+        deflateEnd(&input->deflate->strm);
+        free(input->deflate);
+    }
+    if (input->mapped) {
+        if (input->map_len) {
+            munmap((void *) input->data, input->map_len);
+        }
+        return;
+    }
+    pthread_join(input->reader, NULL);
+    pthread_mutex_destroy(&input->lock);
+    pthread_cond_destroy(&input->cond);
+    for (int i = 0; i < INPUT_BUFS; i++) {
+        free(input->bufs[i]);
+    }
+}
+
+static size_t input_block(struct input *const input, char const **const data) {
+    if (!input->mapped && input->pos == input->len && input_next(input)) {
+        return 0;
+    }
+    size_t const len = input->len - input->pos < INPUT_BUF ? input->len - input->pos : INPUT_BUF; // mapping may be huge
+    *data = input->data + input->pos;
+    input->pos += len;
+
+    return len;
+}
+
+static size_t input_compressed(struct input *const input, size_t const max, char const **const data) {
+    struct input_deflate *const z = input->deflate;
+
+    // Compress until buffer holds whole block (or stream is finished)
+    while (z->len - z->pos < max && !z->done) {
+        // Move rest (shorter than block) to beginning of buffer
+        memmove(z->buf, z->buf + z->pos, z->len - z->pos);
+        z->len -= z->pos;
+        z->pos = 0;
+
+        // Previous block of input was compressed whole, next one is passed
+        if (!z->strm.avail_in && !z->finishing) {
+            char const *block = NULL;
+            size_t const len = input_block(input, &block);
+            z->strm.next_in = (Bytef *) block;
+            z->strm.avail_in = len;
+            z->finishing = !len;
+        }
+
+        z->strm.next_out = (Bytef *) z->buf + z->len;
+        z->strm.avail_out = INPUT_DEFLATE_BUF - z->len;
+        int const ret = deflate(&z->strm, z->finishing ? Z_FINISH : Z_NO_FLUSH);
+        if (ret == Z_STREAM_ERROR) {
+            err_handle("compression of input failed", EXIT);
+        }
+        z->len = INPUT_DEFLATE_BUF - z->strm.avail_out;
+        z->done = ret == Z_STREAM_END;
+    }
+
+    size_t const len = z->len - z->pos < max ? z->len - z->pos : max;
+    *data = z->buf + z->pos;
+    z->pos += len;
+
+    return len;
+}
+
+static void *input_reader(void *const arg) {
+    struct input *const input = arg;
+    ssize_t bytes_read;
+
+    for (unsigned i = 0;; i = (i + 1) % INPUT_BUFS) {
+        // Wait until buffer is consumed
+        pthread_mutex_lock(&input->lock);
+        while (input->ready[i]) {
+            pthread_cond_wait(&input->cond, &input->lock);
+        }
+        pthread_mutex_unlock(&input->lock);
+
+        while ((bytes_read = read(input->fd, input->bufs[i], INPUT_BUF)) < 0 && errno == EINTR);
+
+        // Hand buffer over to sender (or announce end of stream)
+        pthread_mutex_lock(&input->lock);
+        if (bytes_read <= 0) {
+            input->done = 1;
+            input->error = bytes_read < 0;
+        } else {
+            input->lens[i] = bytes_read;
+            input->ready[i] = 1;
+        }
+        pthread_cond_broadcast(&input->cond);
+        pthread_mutex_unlock(&input->lock);
+        if (bytes_read <= 0) {
+            return NULL;
+        }
+    }
+}
+
+static int input_next(struct input *const input) {
+    pthread_mutex_lock(&input->lock);
+
+    // Release consumed buffer (no buffer is held before the first one)
+    if (input->data) {
+        input->ready[input->cur] = 0;
+        input->cur = (input->cur + 1) % INPUT_BUFS;
+        input->data = NULL;
+        pthread_cond_broadcast(&input->cond);
+    }
+
+    // Wait for next buffer
+    while (!input->ready[input->cur] && !input->done) {
+        pthread_cond_wait(&input->cond, &input->lock);
+    }
+    int const end = !input->ready[input->cur];
+    if (!end) {
+        input->data = input->bufs[input->cur];
+        input->len = input->lens[input->cur];
+        input->pos = 0;
+    }
+
+    pthread_mutex_unlock(&input->lock);
+
+    return end;
+}
@@ -0,0 +1,152 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's input of transferred data (mapped regular file, or stream read by background thread).
+ * @details header file
+ */
+
+// GUARD
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "../common/definitions.h"
+
+/// Size of one buffer of stream reader
+#define INPUT_BUF (1 << 20)
+
+/// Number of buffers of stream reader (one is filled while the other one is consumed)
+#define INPUT_BUFS 2
+
+/// Size of buffer of compressed data
+#define INPUT_DEFLATE_BUF 65536
+
+/// Compressor of input, data are read from it by blocks as large as possible and compressed into buffer
+struct input_deflate {
+    z_stream strm; // zlib stream
+    int finishing; // whole input was passed to compressor
+    int done; // compressed stream was finished
+    unsigned len; // length of compressed data in buffer
+    unsigned pos; // position of next compressed data in buffer
+    char buf[INPUT_DEFLATE_BUF]; // compressed data
+};
+
+/**
+ * Input of data, which are handed to encoder without copying.
+ *
+ * Regular file is mapped into memory and read sequentially straight from mapping. Other files (pipes, terminals) are
+ * read by background thread into two large buffers, so reading overlaps encoding and sending of previous buffer.
+ */
+struct input {
+    char const *data; // mapping of file, or buffer of stream being consumed
+    size_t len; // end of data (end of mapping or range, or length of buffer)
+    size_t pos; // position of next data
+    int mapped; // non-zero if file is mapped
+    size_t map_len; // length of mapping
+
+    int fd; // file descriptor of stream
+    pthread_t reader; // thread reading stream
+    pthread_mutex_t lock; // lock of buffers
+    pthread_cond_t cond; // signals change of state of buffers
+    char *bufs[INPUT_BUFS]; // buffers of stream (allocated)
+    size_t lens[INPUT_BUFS]; // lengths of data in buffers
+    int ready[INPUT_BUFS]; // non-zero if buffer is filled by reader and not consumed yet
+    unsigned cur; // buffer consumed by sender
+    int done; // reader reached end of stream (or failed)
+    int error; // reading of stream failed
+    char stage[DNS_MAX_NAME]; // block of stream crossing two buffers
+
+    struct input_deflate *deflate; // compressor (allocated), NULL if data are read as they are
+};
+
+/**
+ * Maps regular file (from its current position) into memory for sequential reading.
+ *
+ * @param input Input to be initialized.
+ * @param file Source file.
+ * @return Zero on success, non-zero if file is not regular or cannot be mapped (input is not initialized).
+ */
+int input_map(struct input *const input, FILE *const file);
+
+/**
+ * Starts background thread reading stream into buffers.
+ *
+ * @param input Input to be initialized.
+ * @param file Source stream.
+ */
+void input_stream(struct input *const input, FILE *const file);
+
+/**
+ * Restricts mapped input to range of file.
+ *
+ * @param input Mapped input.
+ * @param start Offset of first byte of range (from position of file when it was mapped).
+ * @param end Offset behind last byte of range.
+ */
+void input_range(struct input *const input, unsigned long long const start, unsigned long long const end);
+
+/**
+ * Compresses rest of input by zlib, 'input_read()' returns blocks of compressed stream since then.
+ *
+ * @param input Input (not restricted to range).
+ * @param level Compression level (1-9).
+ */
+void input_deflate(struct input *const input, int const level);
+
+/**
+ * Checks whether input is compressed.
+ *
+ * @param input Input.
+ * @return Non-zero if 'input_read()' returns compressed data.
+ */
+int input_deflated(struct input const *const input);
+
+/**
+ * Finds size of rest of input (size of uncompressed data), which is known only for mapped file.
+ *
+ * @param input Input.
+ * @param size Pointer to which save size.
+ * @return Zero if size is known, non-zero otherwise.
+ */
+int input_size(struct input const *const input, unsigned long long *const size);
+
+/**
+ * Computes CRC-32 of prefix of rest of mapped input (uncompressed data).
+ *
+ * @param input Mapped input.
+ * @param len Length of prefix (at most size of input).
+ * @return CRC-32 of prefix.
+ */
+unsigned input_checksum(struct input const *const input, unsigned long long len);
+
+/**
+ * Reads next block of input. Block is shorter than 'max' only at the end of input.
+ *
+ * @param input Input.
+ * @param max Maximum length of block (at most DNS_MAX_NAME).
+ * @param data Pointer to which save address of block (valid until next call).
+ * @return Length of block, zero at the end of input (or if reading failed, see 'input_error()').
+ */
+size_t input_read(struct input *const input, size_t const max, char const **const data);
+
+/**
+ * Checks whether reading of input failed.
+ *
+ * @param input Input.
+ * @return Non-zero if reading failed.
+ */
+int input_error(struct input *const input);
+
+/**
+ * Unmaps file, or waits for reader thread (which has reached end of stream) and frees buffers (and compressor).
+ *
+ * @param input Input.
+ */
+void input_close(struct input *const input);
+
+// END GUARD
+#endif
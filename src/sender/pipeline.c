@@ -0,0 +1,71 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's pipeline of DNS packets written to TCP connection in batches.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "pipeline.h"
+#include "../common/err.h"
+
+void pipeline_init(struct pipeline *const pipeline, int const sockfd, unsigned const batch) {
+    int const on = 1;
+
+    pipeline->sockfd = sockfd;
+    pipeline->batch = batch > PIPELINE_MAX_BATCH ? PIPELINE_MAX_BATCH : batch;
+    pipeline_clear(pipeline);
+
+    if (setsockopt(sockfd, IPPROTO_TCP, pipeline->batch > 1 ? TCP_CORK : TCP_NODELAY, &on, sizeof(on)) < 0) {
+        err_handle("set batching option of socket failed", WARNING);
+    }
+}
+
+char *pipeline_reserve(struct pipeline *const pipeline) {
+    return pipeline->buf + pipeline->len;
+}
+
+void pipeline_commit(struct pipeline *const pipeline, short const dns_len, int const chunk_len) {
+    pipeline->chunk_lens[pipeline->count++] = chunk_len;
+    pipeline->len += dns_len;
+}
+
+int pipeline_full(struct pipeline const *const pipeline) {
+    return pipeline->count >= pipeline->batch;
+}
+
+int pipeline_flush(struct pipeline *const pipeline) {
+    unsigned written = 0;
+
+    // Socket has send timeout, so write() returns partially written batch when connection is congested
+    while (written < pipeline->len) {
+        ssize_t const ret = write(pipeline->sockfd, pipeline->buf + written, pipeline->len - written);
+        if (ret <= 0) {
+            if (ret < 0 && errno == EINTR) {
+                errno = 0;
+                continue;
+            }
+            return 1;
+        }
+        written += ret;
+    }
+
+    return 0;
+}
+
+void pipeline_clear(struct pipeline *const pipeline) {
+    pipeline->count = pipeline->len = 0;
+}
+
+void pipeline_finish(struct pipeline *const pipeline) {
+    int const off = 0;
+
+    if (pipeline->batch > 1 && setsockopt(pipeline->sockfd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off)) < 0) {
+        err_handle("unset batching option of socket failed", WARNING);
+    }
+}
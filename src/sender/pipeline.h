@@ -0,0 +1,91 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's pipeline of DNS packets written to TCP connection in batches.
+ * @details header file
+ */
+
+// GUARD
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "../common/definitions.h"
+
+/// Maximum number of DNS packets in one batch
+#define PIPELINE_MAX_BATCH 256
+
+/**
+ * Pipeline of DNS packets built directly into one large buffer and written to connection by one system call per batch.
+ *
+ * Batches of more packets are written with TCP_CORK set (only full segments are sent, the rest is pushed by
+ * 'pipeline_finish()'), batch of one packet is written with TCP_NODELAY set (every packet is sent immediately).
+ */
+struct pipeline {
+    int sockfd; // connected TCP socket file descriptor
+    unsigned batch; // number of chunks flushed together
+    unsigned count; // number of chunks in buffer (packets, or questions appended to them)
+    unsigned len; // length of data in buffer
+    int chunk_lens[PIPELINE_MAX_BATCH]; // lengths of chunk data in buffer
+    char buf[PIPELINE_MAX_BATCH * DNS_MAX_PACKET]; // packets (TCP length prefixes included)
+};
+
+/**
+ * Initializes empty pipeline and sets TCP options of socket according to batch size.
+ *
+ * @param pipeline Pipeline.
+ * @param sockfd Connected TCP socket file descriptor.
+ * @param batch Number of chunks flushed together, 1 to PIPELINE_MAX_BATCH.
+ */
+void pipeline_init(struct pipeline *const pipeline, int const sockfd, unsigned const batch);
+
+/**
+ * Returns buffer for next packet (pipeline must not be full).
+ *
+ * @param pipeline Pipeline.
+ * @return Buffer of at least DNS_MAX_PACKET bytes.
+ */
+char *pipeline_reserve(struct pipeline *const pipeline);
+
+/**
+ * Appends packet built into buffer returned by 'pipeline_reserve()', or question appended to the last packet.
+ *
+ * @param pipeline Pipeline.
+ * @param dns_len Length of DNS packet (TCP length prefix included), or of appended question.
+ * @param chunk_len Length of chunk data carried by packet (question).
+ */
+void pipeline_commit(struct pipeline *const pipeline, short const dns_len, int const chunk_len);
+
+/**
+ * Checks whether batch is complete and pipeline has to be flushed.
+ *
+ * @param pipeline Pipeline.
+ * @return Non-zero if pipeline is full.
+ */
+int pipeline_full(struct pipeline const *const pipeline);
+
+/**
+ * Writes all packets of pipeline to connection (pipeline is emptied by caller by 'pipeline_clear()', so lengths of
+ * chunks can be reported first).
+ *
+ * @param pipeline Pipeline.
+ * @return Zero on success, non-zero if connection failed.
+ */
+int pipeline_flush(struct pipeline *const pipeline);
+
+/**
+ * Empties pipeline.
+ *
+ * @param pipeline Pipeline.
+ */
+void pipeline_clear(struct pipeline *const pipeline);
+
+/**
+ * Pushes data held back by TCP_CORK to network.
+ *
+ * @param pipeline Pipeline (already flushed).
+ */
+void pipeline_finish(struct pipeline *const pipeline);
+
+// END GUARD
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's template of DNS packets (parts shared by all packets of session) and building of packets from it.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "template.h"
+#include "../common/protocol.h"
+#include "dns_sender_events.h"
+
+void template_init(struct template *const template, char const *const BASE_HOST) {
+    // Header, recursion desired flag is set to true
+    memset(&template->header, 0, sizeof(struct dns_header));
+    template->header.rd = 1;
+    template->header.q_count = htons(1);
+
+    // Name suffix and tails
+    base_host_init(&template->base, BASE_HOST);
+    template->data_tail.type = htons(PROTO_TYPE_DATA);
+    template->data_tail.class = htons(1);
+    template->hello_tail.type = htons(PROTO_TYPE_HELLO);
+    template->hello_tail.class = htons(1);
+
+    // IDs of packets continue from value unique for process (system is asked only once)
+    template->next_id = getpid() ^ time(NULL);
+}
+
+void template_header(struct template *const template, char *const buf) {
+    template->header.id = htons(template->next_id++);
+    memcpy(buf, &template->header, sizeof(struct dns_header));
+}
+
+short build_dns_packet(char const *const data, short const data_len, struct template *const template, struct codec const *const codec, unsigned short const type, char *const buf, struct event *const event) {
+    unsigned short offset = 0;
+
+    // Leave space for packet length (which is required when sending DNS over TCP)
+    offset += DNS_TCP;
+
+    // Append header
+    template_header(template, buf + offset);
+    offset += sizeof(struct dns_header);
+
+    /* Append name of question (data encoded with codec straight into length prefixed labels, followed by precomputed
+     * base host)
+     * Example: (data : "##") and (base : "example.com") will on buffer write '4CDCD7example3com0' ('#' base16 encoded
+     * = 'CD') */
+    offset += name_encode(buf + offset, data, data_len, &template->base, codec);
+    if (EVENT_CHUNKS(event)) {
+        char name[DNS_MAX_NAME + 1];
+        name_text(name, buf + DNS_TCP + sizeof(struct dns_header), &template->base);
+        EVENT(dns_sender__on_chunk_encoded(event->filePath, event->chunkId, name));
+    }
+
+    // Append tail
+    memcpy(buf + offset, type == PROTO_TYPE_HELLO ? &template->hello_tail : &template->data_tail, sizeof(struct dns_question_tail));
+    offset += sizeof(struct dns_question_tail);
+
+    // Fill left space for packet length
+    *((unsigned short *) buf) = htons(offset - DNS_TCP);
+
+    return offset;
+}
+
+short append_dns_question(char const *const data, short const data_len, struct template *const template, struct codec const *const codec, char *const buf, struct event *const event) {
+    char *const dns = buf + DNS_TCP;
+    unsigned short const dns_len = ntohs(*((unsigned short *) buf));
+    struct dns_header *const header = (struct dns_header *) dns;
+    unsigned short offset = dns_len;
+
+    // Find base host ending name of the first question (target of compression pointer)
+    unsigned short base_offset = DNS_HEADER;
+    while (dns[base_offset]) {
+        base_offset += dns[base_offset] + 1;
+    }
+    base_offset -= template->base.wire_len - 1;
+
+    // Append name of question (data labels followed by compression pointer)
+    offset += name_encode_pointer(dns + offset, data, data_len, base_offset, codec);
+    if (EVENT_CHUNKS(event)) {
+        char name[DNS_MAX_NAME + 1];
+        name_text(name, dns + dns_len, &template->base);
+        EVENT(dns_sender__on_chunk_encoded(event->filePath, event->chunkId, name));
+    }
+
+    // Append tail
+    memcpy(dns + offset, &template->data_tail, sizeof(struct dns_question_tail));
+    offset += sizeof(struct dns_question_tail);
+
+    // Update number of questions and packet length
+    header->q_count = htons(ntohs(header->q_count) + 1);
+    *((unsigned short *) buf) = htons(offset);
+
+    return offset - dns_len;
+}
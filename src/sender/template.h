@@ -0,0 +1,78 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's template of DNS packets (parts shared by all packets of session) and building of packets from it.
+ * @details header file
+ */
+
+// GUARD
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+
+#include "../common/definitions.h"
+#include "../common/name.h"
+#include "../common/codec.h"
+#include "../common/events.h"
+
+/**
+ * Parts of DNS query, which are the same for all packets of session, prepared once in wire format. Only payload, length
+ * fields and DNS ID (taken from counter) are written per packet.
+ */
+struct template {
+    struct dns_header header; // header of query (ID is set per packet)
+    struct base_host base; // base host ending name of every question
+    struct dns_question_tail data_tail; // tail of question of data packets (type PROTO_TYPE_DATA)
+    struct dns_question_tail hello_tail; // tail of question of hello (type PROTO_TYPE_HELLO)
+    unsigned short next_id; // DNS ID of next packet
+};
+
+/**
+ * Prepares template of session.
+ *
+ * @param template Template to be filled.
+ * @param BASE_HOST Base host of server program argument.
+ */
+void template_init(struct template *const template, char const *const BASE_HOST);
+
+/**
+ * Writes header of next packet (with next DNS ID) into buffer.
+ *
+ * @param template Template of session.
+ * @param buf Buffer of at least DNS_HEADER bytes.
+ */
+void template_header(struct template *const template, char *const buf);
+
+/**
+ * Puts data into DNS valid packet.
+ *
+ * Header, base host and tail are copied from template of session, DNS ID is taken from its counter.
+ *
+ * @param data Raw data (possibly data chunk) to be encoded into DNS packet.
+ * @param data_len Raw data's length in bytes.
+ * @param template Template of packets of session.
+ * @param codec Codec with which data are encoded.
+ * @param type Type of question (PROTO_TYPE_DATA or PROTO_TYPE_HELLO).
+ * @param buf Buffer to which output DNS packet is constructed.
+ * @param event Event data of session (chunk encoded event is invoked, if chunk events are consumed).
+ * @return Length of DNS packet (TCP length prefix included).
+ */
+short build_dns_packet(char const *const data, short const data_len, struct template *const template, struct codec const *const codec, unsigned short const type, char *const buf, struct event *const event);
+
+/**
+ * Appends data as next question to DNS packet built by 'build_dns_packet()'. Base host of name is replaced with
+ * compression pointer to base host of the first question, so only data labels, pointer and tail are added. Number of
+ * questions and packet length are updated.
+ *
+ * @param data Raw data (possibly data chunk) to be encoded into question.
+ * @param data_len Raw data's length in bytes.
+ * @param template Template of packets of session.
+ * @param codec Codec with which data are encoded.
+ * @param buf Buffer with DNS packet (at least DNS_MAX_PACKET bytes have to be free behind it).
+ * @param event Event data of session (chunk encoded event is invoked, if chunk events are consumed).
+ * @return Length of appended question.
+ */
+short append_dns_question(char const *const data, short const data_len, struct template *const template, struct codec const *const codec, char *const buf, struct event *const event);
+
+// END GUARD
+#endif
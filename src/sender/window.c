@@ -0,0 +1,110 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's sliding window of sent, not yet acknowledged DNS packets.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "window.h"
+
+/**
+ * Updates smoothed round-trip time and its variation by measurement and recomputes retransmission timeout (see RFC
+ * 6298).
+ *
+ * @param window Window.
+ * @param rtt Measured round-trip time in milliseconds.
+ */
+static void window_measure(struct window *const window, long long const rtt);
+
+
+void window_init(struct window *const window, unsigned const size) {
+    window_restart(window, size);
+    window->srtt = -1;
+    window->rttvar = 0;
+    window->rto = WINDOW_RTO;
+}
+
+void window_restart(struct window *const window, unsigned const size) {
+    window->base = window->next = 0;
+    window->size = size > PROTO_WINDOW ? PROTO_WINDOW : size;
+}
+
+void window_backoff(struct window *const window) {
+    window->rto = window->rto * 2 > WINDOW_RTO_MAX ? WINDOW_RTO_MAX : window->rto * 2;
+}
+
+int window_full(struct window const *const window) {
+    return window->next - window->base >= window->size;
+}
+
+int window_empty(struct window const *const window) {
+    return window->next == window->base;
+}
+
+struct window_slot *window_push(struct window *const window) {
+    struct window_slot *const slot = window_slot(window, window->next);
+
+    slot->seq = window->next++;
+    slot->acked = slot->sent = 0;
+    slot->sent_at = 0;
+
+    return slot;
+}
+
+struct window_slot *window_slot(struct window *const window, unsigned const seq) {
+    return window->slots + seq % PROTO_WINDOW;
+}
+
+unsigned window_ack(struct window *const window, struct proto_ack const *const ack) {
+    long long const now = window_now();
+    unsigned acked = 0;
+
+    for (unsigned seq = window->base; seq != window->next; seq++) {
+        struct window_slot *const slot = window_slot(window, seq);
+        unsigned const distance = seq - ack->cum; // wraps for sequence numbers below cumulative acknowledgement
+
+        /* Response echoes DNS ID of query, which it answers, so only that query measures round-trip time (if it was sent
+         * once), chunks acknowledged along with it might have waited for filling of hole before them */
+        if (slot->sent == 1 && !memcmp(slot->dns + DNS_TCP, &ack->id, sizeof(ack->id))) {
+            window_measure(window, now - slot->sent_at);
+        }
+        if (slot->acked) {
+            continue;
+        }
+        if ((int) distance < 0 || (distance > 0 && distance <= PROTO_SACK && ack->sack >> (distance - 1) & 1)) {
+            slot->acked = 1;
+            acked++;
+        }
+    }
+
+    // Slide over acknowledged beginning
+    while (window->base != window->next && window_slot(window, window->base)->acked) {
+        window->base++;
+    }
+
+    return acked;
+}
+
+static void window_measure(struct window *const window, long long const rtt) {
+    // Values are scaled, so fractions of millisecond are kept
+    if (window->srtt < 0) {
+        window->srtt = rtt << 3;
+        window->rttvar = rtt << 1;
+    } else {
+        long long const err = rtt - (window->srtt >> 3);
+        window->srtt += err;
+        window->rttvar += (err < 0 ? -err : err) - (window->rttvar >> 2);
+    }
+
+    long long const rto = (window->srtt >> 3) + window->rttvar;
+    window->rto = rto < WINDOW_RTO_MIN ? WINDOW_RTO_MIN : rto > WINDOW_RTO_MAX ? WINDOW_RTO_MAX : rto;
+}
+
+long long window_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
@@ -0,0 +1,125 @@
+/**
+ * @Author Andrej Pavlovič
+ * @Email <xpavlo14@vutbr.cz>
+ * @Project DNS Tunneling
+ * @Program Sender's sliding window of sent, not yet acknowledged DNS packets.
+ * @details header file
+ */
+
+// GUARD
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include "../common/definitions.h"
+#include "../common/protocol.h"
+
+/// Retransmission timeout in milliseconds until round-trip time is measured
+#define WINDOW_RTO 200
+
+/// Bounds of retransmission timeout in milliseconds
+#define WINDOW_RTO_MIN 20
+#define WINDOW_RTO_MAX 3000
+
+/// One DNS packet (one chunk) in window
+struct window_slot {
+    unsigned seq; // sequence number of chunk
+    int acked; // non-zero if acknowledged by receiver
+    int sent; // number of transmissions
+    long long sent_at; // time of last transmission in milliseconds
+    int chunk_len; // length of chunk data (without sequence number)
+    short dns_len; // length of DNS packet (TCP length prefix included)
+    char dns[DNS_MAX_PACKET]; // DNS packet
+};
+
+/**
+ * Sliding window of chunks.
+ *
+ * Chunks with sequence numbers in interval <base, next) are in flight, slot of chunk is given by its sequence number
+ * modulo PROTO_WINDOW. Retransmission timeout is derived from smoothed round-trip time and its variation (measured on
+ * chunks acknowledged after their first transmission only) and doubled whenever chunk has to be retransmitted.
+ */
+struct window {
+    unsigned base; // lowest sequence number not acknowledged yet
+    unsigned next; // sequence number of next chunk
+    unsigned size; // maximum number of chunks in flight, at most PROTO_WINDOW
+    long long srtt; // smoothed round-trip time in 1/8 milliseconds, -1 until the first measurement
+    long long rttvar; // variation of round-trip time in 1/4 milliseconds
+    long long rto; // retransmission timeout in milliseconds
+    struct window_slot slots[PROTO_WINDOW];
+};
+
+/**
+ * Initializes empty window, round-trip time is not measured yet.
+ *
+ * @param window Window.
+ * @param size Maximum number of chunks in flight, at most PROTO_WINDOW.
+ */
+void window_init(struct window *const window, unsigned const size);
+
+/**
+ * Empties window for chunks numbered from zero again, measured round-trip time is kept.
+ *
+ * @param window Window.
+ * @param size Maximum number of chunks in flight, at most PROTO_WINDOW.
+ */
+void window_restart(struct window *const window, unsigned const size);
+
+/**
+ * Doubles retransmission timeout after chunk timed out (until next measurement of round-trip time).
+ *
+ * @param window Window.
+ */
+void window_backoff(struct window *const window);
+
+/**
+ * Checks whether another chunk can be put into window.
+ *
+ * @param window Window.
+ * @return Non-zero if window is full.
+ */
+int window_full(struct window const *const window);
+
+/**
+ * Checks whether all chunks of window were acknowledged.
+ *
+ * @param window Window.
+ * @return Non-zero if window is empty.
+ */
+int window_empty(struct window const *const window);
+
+/**
+ * Takes slot for next chunk (window must not be full). Slot has its sequence number set and is marked as not sent.
+ *
+ * @param window Window.
+ * @return Slot for next chunk.
+ */
+struct window_slot *window_push(struct window *const window);
+
+/**
+ * Returns slot of chunk in flight.
+ *
+ * @param window Window.
+ * @param seq Sequence number from interval <base, next).
+ * @return Slot of chunk.
+ */
+struct window_slot *window_slot(struct window *const window, unsigned const seq);
+
+/**
+ * Marks chunks acknowledged by receiver, measures round-trip time by answered chunk (if it was sent once) and slides
+ * window over acknowledged beginning.
+ *
+ * @param window Window.
+ * @param ack Acknowledgement received from receiver.
+ * @return Number of newly acknowledged chunks.
+ */
+unsigned window_ack(struct window *const window, struct proto_ack const *const ack);
+
+/**
+ * Returns current time in milliseconds (monotonic clock).
+ *
+ * @return Time in milliseconds.
+ */
+long long window_now(void);
+
+// END GUARD
+#endif
@@ -1,23 +1,89 @@
 # Testing bash script
 
+PORT=15353 # unprivileged port of receiver of extended transfers
+
 ./app/dns_receiver example.com receive/ 2> /dev/null & receiver=$!;
+./app/dns_receiver -p "$PORT" -j 4 -m metrics.prom example.com receive/ 2> /dev/null & receiver_port=$!;
+sleep 0.3;
 
 for i in {1..15};
 do
-  ./app/dns_sender -s 0 -u 127.0.0.1 example.com small/"$i" small 2> /dev/null;
+  ./app/dns_sender -u 127.0.0.1 example.com small/"$i" small 2> /dev/null;
 done;
 for i in {1..15};
 do
-  ./app/dns_sender -s 0 -u 127.0.0.1 example.com medium/"$i" medium 2> /dev/null;
+  ./app/dns_sender -u 127.0.0.1 example.com medium/"$i" medium 2> /dev/null;
 done;
 for i in {1..15};
 do
-  ./app/dns_sender -s 0 -u 127.0.0.1 example.com large/"$i" large 2> /dev/null;
+  ./app/dns_sender -u 127.0.0.1 example.com large/"$i" large 2> /dev/null;
+done;
+
+# UDP transport (default and full window), also concurrent senders
+for i in {1..5};
+do
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 -t udp example.com udp/"$i" medium 2> /dev/null;
+done;
+for i in {1..5};
+do
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 -t udp -w 256 example.com udp_window/"$i" large 2> /dev/null;
+done;
+senders="";
+for i in {1..8};
+do
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 -t udp -w 256 example.com udp_concurrent/"$i" large 2> /dev/null & senders="$senders $!";
+done;
+wait $senders;
+
+# UDP transfer outlasting SOCKET_TIMEOUT (input arrives slowly, session must not time out while it is active)
+for i in {1..8};
+do
+  head -c 100000 large;
+  sleep 1;
+done | ./app/dns_sender -p "$PORT" -u 127.0.0.1 -t udp example.com udp_slow 2> /dev/null;
+for i in {1..8};
+do
+  head -c 100000 large;
+done > udp_slow_src;
+
+# Parallel connections, pipelined questions, base32 labels and deflated input
+for i in {1..5};
+do
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 -c 4 example.com parallel/"$i" large 2> /dev/null;
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 -q 4 example.com questions/"$i" large 2> /dev/null;
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 -e base32 example.com base32/"$i" large 2> /dev/null;
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 -z 6 example.com deflate/"$i" large 2> /dev/null;
+done;
+
+# Plain sender sends baseline-style legacy path packet, which new receiver has to accept
+for i in {1..5};
+do
+  ./app/dns_sender -p "$PORT" -u 127.0.0.1 example.com legacy/"$i" medium 2> /dev/null;
 done;
 
+# Resumed transfer of large file, whose sender is killed partway (it blocks on its log, which is not read anymore)
+head -c 67108864 /dev/urandom > resume_src;
+mkfifo resume_log;
+./app/dns_sender -p "$PORT" -u 127.0.0.1 -r example.com resume resume_src 2> resume_log & sender=$!;
+exec 3< resume_log;
+head -n 20000 <&3 > /dev/null;
+kill -9 $sender > /dev/null;
+wait $sender 2> /dev/null;
+exec 3<&-;
+rm -f resume_log;
+sleep 1;
+if [ ! -f receive/resume.journal ]
+then
+  resume_output="journal of interrupted transfer is missing";
+fi
+
+# Resumed sender continues behind committed prefix, so it sends fewer chunks than the last chunk identifier
+./app/dns_sender -p "$PORT" -u 127.0.0.1 -r example.com resume resume_src 2>&1 > /dev/null \
+  | awk '/^\[SENT\]/ { n++; last = $3 } END { exit !(n && n < last) }' || resume_output+="resumed sender sent whole file";
+
 sleep 1;
 
-output="";
+output="$resume_output";
 
 for i in {1..15};
 do
@@ -31,8 +97,45 @@ for i in {1..15};
 do
   output+=$(diff large receive/large/"$i" 2>&1 > /dev/null)
 done;
+for i in {1..5};
+do
+  output+=$(diff medium receive/udp/"$i" 2>&1 > /dev/null)
+  output+=$(diff large receive/udp_window/"$i" 2>&1 > /dev/null)
+done;
+for i in {1..8};
+do
+  output+=$(diff large receive/udp_concurrent/"$i" 2>&1 > /dev/null)
+done;
+for i in {1..5};
+do
+  output+=$(diff large receive/parallel/"$i" 2>&1 > /dev/null)
+  output+=$(diff large receive/questions/"$i" 2>&1 > /dev/null)
+  output+=$(diff large receive/base32/"$i" 2>&1 > /dev/null)
+  output+=$(diff large receive/deflate/"$i" 2>&1 > /dev/null)
+  output+=$(diff medium receive/legacy/"$i" 2>&1 > /dev/null)
+done;
+
+output+=$(diff udp_slow_src receive/udp_slow 2>&1 > /dev/null)
+rm -f udp_slow_src;
+
+output+=$(diff resume_src receive/resume 2>&1 > /dev/null)
+if [ -f receive/resume.journal ]
+then
+  output+="journal of completed transfer was not removed";
+fi
+rm -f resume_src;
+
+# Every completed transfer to receiver on PORT is counted (udp 19, parallel 20 connections, options 15, legacy 5, resume 1)
+sleep 1;
+transfers=$(awk '/^dns_receiver_transfers_total/ { sum += $2 } END { print sum + 0 }' metrics.prom);
+durations=$(awk '/^dns_receiver_transfer_duration_seconds_count/ { sum += $2 } END { print sum + 0 }' metrics.prom);
+if [ "$transfers" != 60 ] || [ "$durations" != 60 ]
+then
+  output+="metrics counted $transfers transfers and $durations durations";
+fi
+rm -f metrics.prom;
 
-kill $receiver > /dev/null;
+kill $receiver $receiver_port > /dev/null;
 
 if [ "$output" = "" ]
 then